@@ -10,22 +10,41 @@
 */
 
 #include "HeapDebugger.h"
+#include "SlabAllocator.h"
+#include "LargeAllocator.h"
 
 //include OS Specific functions only
 #if defined (_MSC_VER)
 #include "WinFunctions.h"   //This file is NOT included, as this is a display sample
+#include <windows.h>         //CreateThread for the reporter and consumer
 
 #else
 #include "LinuxFunctions.h" //This file is NOT included, as this is a display sample
+#include <csignal>
+#include <cerrno>
+#include <cstring>
+#include <pthread.h>
+#include <semaphore.h>
+#include <unistd.h>
 
 #endif
 
 #include <new>         //for placement new, and overloads
 #include <cstdio>
+#include <cstdint>     //for the shard hash
+#include <cstdlib>     //malloc for the event rings
+#include <cstring>     //memcpy of the kept errors
+#include <chrono>
+#include <cmath>       //log, exp for sampling
+#include <cinttypes>   //PRIu64 for the heap profile
 #include <stdexcept>
 
+//Largest allocation Funcs::PageAlignedAllocate serves
 #define MAXSIZE 16711568
 
+//larger allocations are mapped, so the page path never sees more than it serves
+static_assert(HEAPDEBUGGER_LARGE_BYTES <= MAXSIZE, "HEAPDEBUGGER_LARGE_BYTES must not exceed MAXSIZE");
+
 //Zero initialized at load time
 static int nifty_counter;
 
@@ -36,113 +55,1066 @@ heap_buf;
 // global stream object
 HeapDebugger& debugger = reinterpret_cast<HeapDebugger&> (heap_buf);
 
+//Slabs for small allocations, constant initialized so they work before the
+//debugger is constructed and after it is destroyed
+static SlabAllocator slabs;
+
+//Mappings of large allocations, constant initialized for the same reason
+static LargeAllocator large;
+
+//Event ring of the calling thread, and whether the thread is exiting
+static thread_local AllocationRing* thread_ring = nullptr;
+static thread_local bool thread_exited = false;
+
+//Retires the event ring of a thread when the thread exits
+struct ThreadRingRetirer {
+	//only set, so that using the thread_local constructs it and registers
+	//its destructor for the thread
+	bool armed = false;
+
+	~ThreadRingRetirer()
+	{
+		//every event of the ring is queued before the flag is set
+		if (thread_ring != nullptr)
+			thread_ring->retired.store(true, std::memory_order_release);
+
+		thread_ring = nullptr;
+		thread_exited = true;
+	}
+};
+static thread_local ThreadRingRetirer thread_retirer;
+
 HeapDebugger::HeapDebugger ()
 {
 	createdFile_ = false;
+	deferred_.store(false);
+	rings_.store(nullptr);
+	stopConsumer_.store(false);
+	guardPages_.store(getenv("HEAPDEBUGGER_GUARD_PAGES") != nullptr);
+	large.SetHugePages(getenv("HEAPDEBUGGER_HUGE_PAGES") != nullptr);
+	epoch_.store(0);
+	reporterRunning_ = false;
+	stopReporter_ = false;
+	reportPeriodMs_ = 0;
+	reportAge_ = 0;
+	sampleInterval_.store(0);
+	sampled_.store(false);
+	dropped_.store(0);
+	errors_ = nullptr;
+	errorCount_ = 0;
+
+	//sampling can be turned on without changing the program
+	if (const char* sampleBytes = getenv("HEAPDEBUGGER_SAMPLE_BYTES"))
+		SetSampleInterval(strtoull(sampleBytes, nullptr, 10));
+
+	//and so can profiles on SIGUSR2
+	if (const char* profilePrefix = getenv("HEAPDEBUGGER_HEAP_PROFILE"))
+		StartProfileSignal(profilePrefix);
+
+	//and reports of allocations that lived through a whole period
+	if (const char* reportMs = getenv("HEAPDEBUGGER_REPORT_MS"))
+		StartReporter(static_cast<unsigned int>(strtoul(reportMs, nullptr, 10)), 1);
 }
 
 //Write all memory leak data to the CSV on destruction
 HeapDebugger::~HeapDebugger ()
 {
+	//no more profiles or reports, the tables are about to go
+	StopProfileSignal();
+	StopReporter();
+
+	//stop the consumer, and track whatever is still queued
+	SetDeferredTracking(false);
+	DrainEvents();
+
+	//finish the trace file
+	StopTrace();
+
   //clean-up
 	if (!createdFile_)
 	{
-		//Loop through all memory data
-		for (std::list<MemoryData>::iterator it = allocated_list.begin(); it != allocated_list.end(); it++)
+		//totals of the leaks, and what they stand for when sampling
+		size_t leakCount = 0, leakBytes = 0;
+		double estimatedCount = 0.0, estimatedBytes = 0.0;
+
+		//Report from a copy of the shards, so the allocations and frees made
+		//while writing the report are still tracked by the real tables
+		AddressTable<MemoryData> leaks;
+
+		for (Shard& shard : shards_)
+		{
+			SpinLockGuard guard(shard.lock);
+			shard.allocated.ForEach([&leaks](MemoryData& data) { leaks.Insert(data); });
+		}
+
+		//errors of freed memory, their records in the shards may be gone
+		FreedRecord* freed = nullptr;
+		size_t freedCount = 0;
 		{
-			if (it->deleted == false)
+			SpinLockGuard guard(errorsLock_);
+			if (errorCount_ != 0)
+				freed = static_cast<FreedRecord*>(malloc(errorCount_ * sizeof(FreedRecord)));
+			if (freed != nullptr)
 			{
-				//if new-delete mismatch, preserve error type
-				if (it->errorType == ErrorType::NEW_DELETE_MISMATCH)
-					printf("New-delete mismatch LEAK detected, not overwriting error type.\n");
-				else
-				{
-					printf("Memory leak detected at %p, of type %s\n", it->address, it->type == MemoryType::SINGLE_BLOCK ? "Single Block" : "Array");
-					it->errorType = ErrorType::LEAK;
-				}
-				WriteCSV(*it);
+				memcpy(freed, errors_, errorCount_ * sizeof(FreedRecord));
+				freedCount = errorCount_;
 			}
+		}
+
+		//Resolve every call site of the report in one pass, leaks share few of them
+		{
+			std::lock_guard<std::recursive_mutex> guard(csvLock_);
+
+			//frames of the allocation stacks as well
+			auto addStack = [this](uint32_t stackId)
+			{
+				void* const* frames;
+				int count = stacks_.Frames(stackId, frames);
+				for (int i = 0; i < count; i++)
+					symbols_.Add(frames[i], false);
+			};
 
-			else if (it->errorType != ErrorType::NONE)
+			leaks.ForEach([&](MemoryData& data)
+			{
+				symbols_.Add(data.returnAddress, data.errorType == ErrorType::NEW_DELETE_MISMATCH);
+				addStack(data.stackId);
+			});
+			for (size_t i = 0; i < freedCount; i++)
 			{
-				WriteCSV(*it);
+				symbols_.Add(freed[i].returnAddress, true);
+				addStack(freed[i].stackId);
 			}
+			symbols_.Resolve();
 		}
+
+		//Everything still allocated is a leak
+		leaks.ForEach([&](MemoryData& data)
+		{
+			double weight = SampleWeight(data.bytes);
+			leakCount++;
+			leakBytes += data.bytes;
+			estimatedCount += weight;
+			estimatedBytes += weight * data.bytes;
+
+			//if new-delete mismatch, preserve error type
+			if (data.errorType == ErrorType::NEW_DELETE_MISMATCH)
+				printf("New-delete mismatch LEAK detected, not overwriting error type.\n");
+			else
+			{
+				printf("Memory leak detected at %p, of type %s\n", data.address, MemoryTypeName(data.type));
+				data.errorType = ErrorType::LEAK;
+			}
+			WriteCSV(data);
+		});
+
+		//Freed memory that had errors
+		for (size_t i = 0; i < freedCount; i++)
+			WriteCSV(freed[i].ToMemoryData());
+		free(freed);
+
+		//only some allocations were tracked, scale the leaks up to an estimate
+		if (sampled_.load() && leakCount != 0)
+			printf("Sampled leaks: %zu allocations, %zu bytes. Estimated leaks: %.0f allocations, %.0f bytes\n",
+				leakCount, leakBytes, estimatedCount, estimatedBytes);
+
+		//the tables ran out of memory, so some errors may be false
+		if (size_t dropped = dropped_.load())
+			printf("%zu allocations were not tracked, the tables could not grow. Their deletes were reported as NO_HEAP_POINTER\n", dropped);
 	}
+
+	//final flush of everything still buffered
+	CloseCSV();
+
+	std::lock_guard<std::recursive_mutex> guard(csvLock_);
+	outstandingFile_.Close();
+
+	SpinLockGuard errorsGuard(errorsLock_);
+	free(errors_);
+	errors_ = nullptr;
+	errorCount_ = 0;
 }
 
 //Create csv file if it does not exist
 void HeapDebugger::CreateCSV()
 {
+	std::lock_guard<std::recursive_mutex> guard(csvLock_);
+
 	if (!createdFile_)
 	{
-		std::ofstream csvFile("DebugLog.csv", std::ofstream::out);
-		csvFile << "Message, File, Line, Bytes, Address, Additional Info\n";
-		csvFile.close(); createdFile_ = true;
+		file_.Open("DebugLog.csv", "Message, File, Line, Bytes, Address, Additional Info\n");
+		createdFile_ = true;
 	}
 }
 
 //Write data to the CSV file
 void HeapDebugger::WriteCSV(MemoryData data)
 {
+	std::lock_guard<std::recursive_mutex> guard(csvLock_);
+
 	CreateCSV();
 
-	std::ofstream file("DebugLog.csv", std::ios_base::app);
+	char buff[4096];
+	int length = FormatCSV(data, buff, sizeof(buff));
+
+	//snprintf returns the untruncated length
+	if (length > 0)
+		file_.Write(buff, length < 4096 ? length : 4095);
+}
 
+//One CSV line of an allocation
+int HeapDebugger::FormatCSV(const MemoryData& data, char* buff, size_t size)
+{
 	const char* msg = data.errorType == ErrorType::LEAK ? "Memory Leak" :
 		data.errorType == ErrorType::DOUBLE_DELETE ? "Double Delete" : 
 		data.errorType == ErrorType::NO_HEAP_POINTER ? "Non Heap Pointer Deletion" : 
-		data.errorType == ErrorType::NEW_DELETE_MISMATCH ? "New-delete mismatch" : "None";
-
-	int LineNo = 0;
-	const char* fileName;
+		data.errorType == ErrorType::NEW_DELETE_MISMATCH ? "New-delete mismatch" :
+		data.errorType == ErrorType::OUTSTANDING ? "Outstanding Allocation" :
+		data.errorType == ErrorType::SIZE_MISMATCH ? "Sized delete mismatch" : "None";
 
 	bool isDoubleOrHeapDeleteOrMismatch = data.errorType == ErrorType::DOUBLE_DELETE ? true : 
-		data.errorType == ErrorType::NO_HEAP_POINTER ? true : data.errorType == ErrorType::NEW_DELETE_MISMATCH ? true : false;
+		data.errorType == ErrorType::NO_HEAP_POINTER ? true : data.errorType == ErrorType::NEW_DELETE_MISMATCH ? true :
+		data.errorType == ErrorType::SIZE_MISMATCH ? true : false;
 
-	//Windows SPECIFIC GET FUNCTION 
-	#if defined (_MSC_VER)
-		Funcs::GetSymFromAddress(data.returnAddress, &LineNo, fileName, isDoubleOrHeapDeleteOrMismatch);
-	#else 
-		Basic_String str = Funcs::GetSymFromAddress(data.returnAddress, &LineNo, isDoubleOrHeapDeleteOrMismatch);
-		fileName = str.c_str();
-	#endif
+	//every return address is only resolved once
+	const Symbol& symbol = symbols_.Lookup(data.returnAddress, isDoubleOrHeapDeleteOrMismatch);
+	const char* fileName = symbol.file != nullptr ? symbol.file : "";
+	int LineNo = symbol.line;
 
-	const char* AddInfo = "None";
+	//the call path of the allocation, outstanding allocations also name their epoch
+	char stack[2048];
+	int prefix = data.errorType == ErrorType::OUTSTANDING ? snprintf(stack, sizeof(stack), "epoch %u: ", data.epoch) : 0;
+	FormatStack(data.stackId, stack + prefix, sizeof(stack) - prefix);
+	const char* AddInfo = stack[0] != '\0' ? stack : "None";
 
-	char buff[4096];
+	int length;
 
 	#if defined (_MSC_VER)
-		sprintf_s(buff, 4096, "%s,%s,%d,%zu,%p,%s\n", msg, fileName, LineNo, data.bytes, data.address, AddInfo);
+		length = sprintf_s(buff, size, "%s,%s,%d,%zu,%p,%s\n", msg, fileName, LineNo, data.bytes, data.address, AddInfo);
 	#else 
-		sprintf(buff, "%s,%s,%d,%zu,%p,%s\n", msg, fileName, LineNo, data.bytes, data.address, AddInfo);
+		length = snprintf(buff, size, "%s,%s,%d,%zu,%p,%s\n", msg, fileName, LineNo, data.bytes, data.address, AddInfo);
 	#endif
 
-	file << buff;
-	file.close();
+	return length;
 }
 
 //Close the csv file.
 void HeapDebugger::CloseCSV()
 {
+	std::lock_guard<std::recursive_mutex> guard(csvLock_);
+
+	//write out everything that is buffered
+	file_.Close();
 	createdFile_ = false;
 }
 
 //Write final data to the CSV
 void HeapDebugger::CreateWriteCloseCSV(MemoryData data)
 {
+	std::lock_guard<std::recursive_mutex> guard(csvLock_);
+
 	CreateCSV();
 	WriteCSV(data);
 	CloseCSV();
 }
 
-//Add memory to the observed list
+//Shard that tracks an address, picked from the high bits of a multiplicative
+//hash so it does not correlate with the slot inside the shard's table
+HeapDebugger::Shard& HeapDebugger::ShardOf(MemoryAddress address)
+{
+	uint64_t key = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(address));
+	return shards_[((key * 0x9e3779b97f4a7c15ULL) >> 32) % HEAPDEBUGGER_SHARDS];
+}
+
+//Memory for operator new
+MemoryAddress HeapDebugger::AllocateMemory(size_t size)
+{
+	//large sizes are mapped on their own, also in guard page mode
+	if (size > HEAPDEBUGGER_LARGE_BYTES)
+		return large.Allocate(size, 0);
+
+	//slabs unless overflows are being hunted, the sizes between get pages
+	if (!guardPages_.load(std::memory_order_relaxed))
+	{
+		if (MemoryAddress memory = slabs.Allocate(size))
+			return memory;
+	}
+
+	return Funcs::PageAlignedAllocate(size);
+}
+
+//Alignment of the memory from Funcs::PageAlignedAllocate
+static const size_t PAGE_ALIGNMENT = 4096;
+
+//Memory for the aligned forms of operator new
+MemoryAddress HeapDebugger::AllocateAlignedMemory(size_t size, size_t alignment)
+{
+	//slab classes whose size is a multiple of the alignment have aligned objects
+	if (!guardPages_.load(std::memory_order_relaxed))
+	{
+		if (MemoryAddress memory = slabs.Allocate(size, alignment))
+			return memory;
+	}
+
+	//mappings can be aligned to anything
+	if (alignment > PAGE_ALIGNMENT || size > HEAPDEBUGGER_LARGE_BYTES)
+		return large.Allocate(size, alignment);
+
+	return Funcs::PageAlignedAllocate(size);
+}
+
+//Keep an error of freed memory for the report at exit
+void HeapDebugger::KeepError(const MemoryData& error)
+{
+	SpinLockGuard guard(errorsLock_);
+
+	//calloc'ed, keeping an error must not come back into operator new
+	if (errors_ == nullptr)
+		errors_ = static_cast<FreedRecord*>(calloc(HEAPDEBUGGER_KEPT_ERRORS, sizeof(FreedRecord)));
+
+	if (errors_ != nullptr && errorCount_ < HEAPDEBUGGER_KEPT_ERRORS)
+		errors_[errorCount_++] = FreedRecord(error);
+}
+
+//Turn guard page mode on or off, memory is freed by where it came from
+void HeapDebugger::SetGuardPages(bool enabled)
+{
+	guardPages_.store(enabled);
+}
+
+//Turn huge pages for large allocations on or off
+void HeapDebugger::SetHugePages(bool enabled)
+{
+	large.SetHugePages(enabled);
+}
+
+//Return memory to the slabs, mapping or pages it came from
+void HeapDebugger::ReleaseMemory(MemoryAddress address, size_t noBytes)
+{
+	if (slabs.Release(address) == SlabAllocator::NOT_SLAB && !large.Release(address))
+		Funcs::FreePageMemory(address, noBytes);
+}
+
+//Add memory to the observed table
 void HeapDebugger::ObserveMemory(MemoryData data)
 {
 	//std::cout << "Allocated " << data.bytes << " bytes at address " << data.address << std::endl;
-	allocated_list.push_back(data);
+
+	if (trace_.IsActive())
+		trace_.Record(TRACE_ALLOC, data.address, data.bytes, data.returnAddress, static_cast<int>(data.type));
+
+	//with sampling, most allocations are not tracked at all
+	if (sampleInterval_.load(std::memory_order_relaxed) != 0 && !SampleAllocation(data.bytes))
+		return;
+
+	//the whole call path, only for allocations that are tracked
+	data.stackId = CaptureStack(data.returnAddress);
+	stacks_.CountAllocation(data.stackId, data.bytes);
+
+	//with deferred tracking, only queue the allocation. Sampled allocations
+	//are rare and tracked right away, so a free that finds nothing in the
+	//tables knows the allocation was not sampled without draining the rings.
+	if (deferred_.load(std::memory_order_relaxed) && !sampled_.load(std::memory_order_relaxed) && QueueMemory(data))
+		return;
+
+	TrackMemory(data);
+}
+
+//Add an allocation to its shard
+void HeapDebugger::TrackMemory(const MemoryData& data)
+{
+	Shard& shard = ShardOf(data.address);
+	SpinLockGuard guard(shard.lock);
+
+	//the address was handed out again, so it is no longer freed
+	shard.freed.Erase(data.address);
+
+	//queued allocations get the epoch they are drained in, a few milliseconds late
+	if (MemoryData* tracked = shard.allocated.Insert(data))
+		tracked->epoch = epoch_.load(std::memory_order_relaxed);
+	else
+		dropped_.fetch_add(1, std::memory_order_relaxed);
+}
+
+//Intern the calling thread's stack, from the caller of operator new
+uint32_t HeapDebugger::CaptureStack(MemoryAddress returnAddress)
+{
+	//room for the frames of the debugger itself, they are skipped
+	void* frames[HEAPDEBUGGER_STACK_DEPTH + 8];
+	int count = HEAPDEBUGGER_STACK_DEPTH > 0 ? StackDepot::Capture(frames, HEAPDEBUGGER_STACK_DEPTH + 8) : 0;
+
+	int first = 0;
+	while (first < count && frames[first] != returnAddress)
+		first++;
+
+	//the walk did not reach the caller, keep the return address alone
+	if (first == count)
+	{
+		frames[0] = returnAddress;
+		first = 0;
+		count = 1;
+	}
+
+	count -= first;
+	if (count > HEAPDEBUGGER_STACK_DEPTH)
+		count = HEAPDEBUGGER_STACK_DEPTH > 0 ? HEAPDEBUGGER_STACK_DEPTH : 1;
+
+	return stacks_.Intern(frames + first, count);
+}
+
+//Text of a stack for the CSV, innermost frame first
+void HeapDebugger::FormatStack(uint32_t stackId, char* text, size_t size)
+{
+	void* const* frames;
+	int count = stacks_.Frames(stackId, frames);
+	size_t used = 0;
+
+	text[0] = '\0';
+
+	for (int i = 0; i < count && used < size; i++)
+	{
+		const Symbol& symbol = symbols_.Lookup(frames[i], false);
+
+		int length = snprintf(text + used, size - used, "%s%s:%d", i != 0 ? " <- " : "",
+			symbol.file != nullptr ? symbol.file : "", symbol.line);
+		if (length < 0)
+			break;
+
+		used += length;
+	}
+}
+
+//State of the sampler of the calling thread
+static thread_local int64_t bytes_until_sample = 0;
+static thread_local bool sampler_started = false;
+static thread_local uint64_t sampler_random = 0;
+
+//Whether the calling thread's next allocation of 'bytes' bytes is sampled
+bool HeapDebugger::SampleAllocation(size_t bytes)
+{
+	bytes_until_sample -= static_cast<int64_t>(bytes);
+
+	//fast path, still inside the current interval
+	if (bytes_until_sample > 0 && sampler_started)
+		return false;
+
+	//the first allocation of a thread only draws the first interval
+	bool sample = sampler_started;
+
+	if (!sampler_started)
+	{
+		sampler_random = reinterpret_cast<uintptr_t>(&bytes_until_sample) ^ 0x9e3779b97f4a7c15ULL;
+		sampler_started = true;
+	}
+
+	//xorshift, then a geometric distance with the configured mean, so every
+	//allocated byte has the same chance of being the one that is sampled
+	sampler_random ^= sampler_random << 13;
+	sampler_random ^= sampler_random >> 7;
+	sampler_random ^= sampler_random << 17;
+
+	double uniform = ((sampler_random >> 11) + 1) * (1.0 / 9007199254740992.0);
+	double interval = static_cast<double>(sampleInterval_.load(std::memory_order_relaxed));
+
+	bytes_until_sample = static_cast<int64_t>(-std::log(uniform) * interval) + 1;
+
+	return sample || bytes_until_sample <= 0;
+}
+
+//Change the sampling interval
+void HeapDebugger::SetSampleInterval(size_t bytes)
+{
+	if (bytes != 0 && !sampled_.exchange(true))
+	{
+		//allocations queued before sampling are tracked, frees of unknown
+		//addresses do not look in the rings anymore
+		DrainEvents();
+	}
+
+	sampleInterval_.store(bytes);
+}
+
+//An allocation of 'bytes' bytes is sampled with probability 1 - exp(-bytes / interval)
+double HeapDebugger::SampleWeight(size_t bytes) const
+{
+	size_t interval = sampleInterval_.load(std::memory_order_relaxed);
+
+	if (interval == 0 || bytes == 0)
+		return 1.0;
+
+	return 1.0 / (1.0 - std::exp(-static_cast<double>(bytes) / interval));
+}
+
+//Turn deferred tracking on or off
+void HeapDebugger::SetDeferredTracking(bool enabled)
+{
+	std::lock_guard<std::mutex> guard(deferredLock_);
+
+	if (enabled == deferred_.load())
+		return;
+
+	if (enabled)
+	{
+		stopConsumer_.store(false);
+
+		//a native thread, std::thread would allocate its state with operator new
+		//and the consumer would find it among the outstanding allocations
+		#if defined (_MSC_VER)
+			consumer_ = CreateThread(nullptr, 0, &HeapDebugger::ConsumerThread, this, 0, nullptr);
+			if (consumer_ == nullptr)
+				return;
+		#else
+			if (pthread_create(&consumer_, nullptr, &HeapDebugger::ConsumerThread, this) != 0)
+				return;
+		#endif
+
+		deferred_.store(true);
+	}
+	else
+	{
+		deferred_.store(false);
+		stopConsumer_.store(true);
+
+		#if defined (_MSC_VER)
+			WaitForSingleObject(consumer_, INFINITE);
+			CloseHandle(consumer_);
+		#else
+			pthread_join(consumer_, nullptr);
+		#endif
+
+		//allocations queued before the flag was cleared
+		DrainEvents();
+	}
+}
+
+//Start writing the binary trace
+bool HeapDebugger::StartTrace(const char* path, size_t maxRecords)
+{
+	std::lock_guard<std::mutex> guard(traceLock_);
+	return trace_.Start(path, maxRecords);
+}
+
+//Finish the binary trace
+void HeapDebugger::StopTrace()
+{
+	std::lock_guard<std::mutex> guard(traceLock_);
+	trace_.Stop();
+}
+
+//Live allocations of one call stack, keyed by the stack id
+struct StackUsage
+{
+	MemoryAddress address;
+	uint64_t count;
+	uint64_t bytes;
+};
+
+//Write a gperftools text heap profile
+bool HeapDebugger::WriteHeapProfile(const char* path)
+{
+	//queued allocations are live as well
+	DrainEvents();
+
+	//live allocations by stack, one shard at a time so allocating threads
+	//only ever wait for one shard
+	AddressTable<StackUsage> usage;
+
+	for (Shard& shard : shards_)
+	{
+		SpinLockGuard guard(shard.lock);
+
+		shard.allocated.ForEach([&usage](MemoryData& data)
+		{
+			MemoryAddress key = reinterpret_cast<MemoryAddress>(static_cast<uintptr_t>(data.stackId));
+			if (key == nullptr)
+				return;
+
+			StackUsage* entry = usage.Find(key);
+			if (entry == nullptr)
+			{
+				StackUsage added = { key, 0, 0 };
+				entry = usage.Insert(added);
+				if (entry == nullptr)
+					return;
+			}
+
+			entry->count++;
+			entry->bytes += data.bytes;
+		});
+	}
+
+	FILE* file = nullptr;
+
+	#if defined (_MSC_VER)
+		if (fopen_s(&file, path, "w") != 0)
+			file = nullptr;
+	#else
+		file = fopen(path, "w");
+	#endif
+
+	if (file == nullptr)
+		return false;
+
+	//totals go first, so add everything up before writing
+	uint32_t stackCount = static_cast<uint32_t>(stacks_.Size());
+	uint64_t liveCount = 0, liveBytes = 0, totalCount = 0, totalBytes = 0;
+
+	for (uint32_t id = 1; id <= stackCount; id++)
+	{
+		uint64_t count, bytes;
+		stacks_.Allocations(id, count, bytes);
+		totalCount += count;
+		totalBytes += bytes;
+	}
+
+	usage.ForEach([&](StackUsage& entry)
+	{
+		liveCount += entry.count;
+		liveBytes += entry.bytes;
+	});
+
+	//sampled profiles name their rate, so pprof scales them back up
+	size_t interval = sampleInterval_.load(std::memory_order_relaxed);
+
+	fprintf(file, "heap profile: %6" PRIu64 ": %8" PRIu64 " [%6" PRIu64 ": %8" PRIu64 "] @ ", liveCount, liveBytes,
+		totalCount, totalBytes);
+
+	if (interval != 0)
+		fprintf(file, "heap_v2/%zu\n", interval);
+	else
+		fprintf(file, "heapprofile\n");
+
+	//one line per stack, live and then all allocations, then the frames
+	for (uint32_t id = 1; id <= stackCount; id++)
+	{
+		uint64_t count, bytes;
+		stacks_.Allocations(id, count, bytes);
+
+		StackUsage* live = usage.Find(reinterpret_cast<MemoryAddress>(static_cast<uintptr_t>(id)));
+		if (count == 0 && live == nullptr)
+			continue;
+
+		void* const* frames;
+		int frameCount = stacks_.Frames(id, frames);
+
+		fprintf(file, "%6" PRIu64 ": %8" PRIu64 " [%6" PRIu64 ": %8" PRIu64 "] @", live ? live->count : 0,
+			live ? live->bytes : 0, count, bytes);
+
+		for (int i = 0; i < frameCount; i++)
+			fprintf(file, " 0x%016" PRIxPTR, reinterpret_cast<uintptr_t>(frames[i]));
+
+		fprintf(file, "\n");
+	}
+
+	//the address space layout lets pprof find the symbols of every frame
+	#if !defined (_MSC_VER)
+		if (FILE* maps = fopen("/proc/self/maps", "r"))
+		{
+			fprintf(file, "\nMAPPED_LIBRARIES:\n");
+
+			char buffer[4096];
+			size_t read;
+			while ((read = fread(buffer, 1, sizeof(buffer), maps)) > 0)
+				fwrite(buffer, 1, read, file);
+
+			fclose(maps);
+		}
+	#endif
+
+	bool written = ferror(file) == 0;
+	return fclose(file) == 0 && written;
+}
+
+#if !defined (_MSC_VER)
+//Profile dump thread, woken by SIGUSR2 through the semaphore
+static sem_t profile_semaphore;
+static pthread_t profile_thread;
+static bool profile_running = false;
+static std::atomic<bool> profile_stop(false);
+static char profile_prefix[256];
+//Handler that was installed before, restored when profiling stops
+static struct sigaction profile_previous;
+//Serializes starting and stopping
+static std::mutex profile_lock;
+
+//Only posts the semaphore, nothing else is safe inside a signal handler
+static void ProfileSignalHandler(int)
+{
+	int savedError = errno;
+	sem_post(&profile_semaphore);
+	errno = savedError;
+}
+
+//Body of the dump thread
+static void* ProfileThread(void*)
+{
+	unsigned int dumps = 0;
+
+	for (;;)
+	{
+		while (sem_wait(&profile_semaphore) != 0 && errno == EINTR)
+			;
+
+		if (profile_stop.load())
+			return nullptr;
+
+		char path[512];
+		snprintf(path, sizeof(path), "%s.%d.%04u.heap", profile_prefix, static_cast<int>(getpid()), ++dumps);
+
+		if (debugger.WriteHeapProfile(path))
+			printf("Heap profile written to %s\n", path);
+	}
+}
+#endif
+
+//Write a profile every time the process gets SIGUSR2
+bool HeapDebugger::StartProfileSignal(const char* prefix)
+{
+	#if defined (_MSC_VER)
+		//there is no SIGUSR2 on Windows, call WriteHeapProfile instead
+		(void)prefix;
+		return false;
+	#else
+		std::lock_guard<std::mutex> guard(profile_lock);
+
+		if (profile_running)
+			return false;
+
+		snprintf(profile_prefix, sizeof(profile_prefix), "%s", prefix);
+
+		if (sem_init(&profile_semaphore, 0, 0) != 0)
+			return false;
+
+		//a native thread, std::thread would allocate its state with operator new
+		profile_stop.store(false);
+		if (pthread_create(&profile_thread, nullptr, &ProfileThread, nullptr) != 0)
+		{
+			sem_destroy(&profile_semaphore);
+			return false;
+		}
+
+		struct sigaction action;
+		memset(&action, 0, sizeof(action));
+		action.sa_handler = &ProfileSignalHandler;
+		action.sa_flags = SA_RESTART;
+		sigemptyset(&action.sa_mask);
+		sigaction(SIGUSR2, &action, &profile_previous);
+
+		profile_running = true;
+		return true;
+	#endif
+}
+
+//Stop writing profiles on SIGUSR2
+void HeapDebugger::StopProfileSignal()
+{
+	#if !defined (_MSC_VER)
+		std::lock_guard<std::mutex> guard(profile_lock);
+
+		if (!profile_running)
+			return;
+
+		sigaction(SIGUSR2, &profile_previous, nullptr);
+
+		profile_stop.store(true);
+		sem_post(&profile_semaphore);
+		pthread_join(profile_thread, nullptr);
+		sem_destroy(&profile_semaphore);
+
+		profile_running = false;
+	#endif
+}
+
+//Epoch new allocations are stamped with
+uint32_t HeapDebugger::CurrentEpoch() const
+{
+	return epoch_.load();
+}
+
+//Start a new epoch
+uint32_t HeapDebugger::AdvanceEpoch()
+{
+	return epoch_.fetch_add(1) + 1;
+}
+
+//Write every live allocation made in 'sinceEpoch' or later
+size_t HeapDebugger::ReportOutstanding(uint32_t sinceEpoch)
+{
+	return ReportEpochs(sinceEpoch, epoch_.load());
+}
+
+//Slots of a shard read per lock, so at most this many allocations are copied at once
+static const size_t REPORT_STEP = 256;
+
+//Report the live allocations of epochs 'first' to 'last'
+size_t HeapDebugger::ReportEpochs(uint32_t first, uint32_t last)
+{
+	//queued allocations are live as well
+	DrainEvents();
+
+	size_t reported = 0;
+	MemoryData found[REPORT_STEP];
+
+	for (Shard& shard : shards_)
+	{
+		size_t slot = 0;
+
+		do
+		{
+			size_t count = 0;
+
+			//copy a few slots under the lock, and write them once it is released
+			{
+				SpinLockGuard guard(shard.lock);
+
+				slot = shard.allocated.ForEachInRange(slot, REPORT_STEP, [&](MemoryData& data)
+				{
+					if (data.epoch >= first && data.epoch <= last)
+						found[count++] = data;
+				});
+			}
+
+			if (count == 0)
+				continue;
+
+			std::lock_guard<std::recursive_mutex> guard(csvLock_);
+
+			if (!outstandingFile_.IsOpen())
+				outstandingFile_.Open("OutstandingLog.csv", "Message, File, Line, Bytes, Address, Additional Info\n");
+
+			for (size_t i = 0; i < count; i++)
+			{
+				found[i].errorType = ErrorType::OUTSTANDING;
+
+				char buff[4096];
+				int length = FormatCSV(found[i], buff, sizeof(buff));
+
+				if (length > 0)
+					outstandingFile_.Write(buff, length < 4096 ? length : 4095);
+			}
+
+			reported += count;
+		} while (slot != 0);
+	}
+
+	return reported;
+}
+
+//Start the reporter thread
+bool HeapDebugger::StartReporter(unsigned int periodMs, uint32_t ageEpochs)
+{
+	std::lock_guard<std::mutex> guard(reporterLock_);
+
+	if (reporterRunning_ || periodMs == 0)
+		return false;
+
+	reportPeriodMs_ = periodMs;
+	reportAge_ = ageEpochs;
+	stopReporter_ = false;
+
+	//a native thread, std::thread would allocate its state with operator new
+	//and the reporter would find it among the outstanding allocations
+	#if defined (_MSC_VER)
+		reporter_ = CreateThread(nullptr, 0, &HeapDebugger::ReporterThread, this, 0, nullptr);
+		reporterRunning_ = reporter_ != nullptr;
+	#else
+		reporterRunning_ = pthread_create(&reporter_, nullptr, &HeapDebugger::ReporterThread, this) == 0;
+	#endif
+
+	return reporterRunning_;
+}
+
+//Stop the reporter thread
+void HeapDebugger::StopReporter()
+{
+	{
+		std::lock_guard<std::mutex> guard(reporterLock_);
+
+		if (!reporterRunning_)
+			return;
+
+		stopReporter_ = true;
+	}
+
+	reporterWake_.notify_one();
+
+	#if defined (_MSC_VER)
+		WaitForSingleObject(reporter_, INFINITE);
+		CloseHandle(reporter_);
+	#else
+		pthread_join(reporter_, nullptr);
+	#endif
+
+	std::lock_guard<std::mutex> guard(reporterLock_);
+	reporterRunning_ = false;
+}
+
+//Entry point of the reporter thread
+#if defined (_MSC_VER)
+unsigned long __stdcall HeapDebugger::ReporterThread(void* heapDebugger)
+{
+	static_cast<HeapDebugger*>(heapDebugger)->ReportLoop();
+	return 0;
+}
+#else
+void* HeapDebugger::ReporterThread(void* heapDebugger)
+{
+	static_cast<HeapDebugger*>(heapDebugger)->ReportLoop();
+	return nullptr;
+}
+#endif
+
+//Advance the epoch every period and report the epochs that became old enough
+void HeapDebugger::ReportLoop()
+{
+	//first epoch that was not reported yet
+	uint32_t next = 0;
+
+	std::unique_lock<std::mutex> lock(reporterLock_);
+
+	for (;;)
+	{
+		reporterWake_.wait_for(lock, std::chrono::milliseconds(reportPeriodMs_), [this] { return stopReporter_; });
+
+		if (stopReporter_)
+			return;
+
+		uint32_t age = reportAge_;
+		lock.unlock();
+
+		//every epoch before the new one is complete, the ones that are 'age'
+		//epochs older than that have lived through whole periods
+		uint32_t now = AdvanceEpoch();
+
+		if (now > age && now - age - 1 >= next)
+		{
+			ReportEpochs(next, now - age - 1);
+			next = now - age;
+		}
+
+		lock.lock();
+	}
+}
+
+//Queue an allocation in the calling thread's ring
+bool HeapDebugger::QueueMemory(const MemoryData& data)
+{
+	AllocationRing* ring = ThreadRing();
+
+	//a full ring, or a thread that is exiting, tracks the allocation itself
+	if (ring == nullptr)
+		return false;
+
+	AllocationEvent event;
+	event.address = data.address;
+	event.bytes = data.bytes;
+	event.returnAddress = data.returnAddress;
+	event.type = data.type;
+	event.stackId = data.stackId;
+
+	return ring->Push(event);
 }
 
+//Ring of the calling thread, created on first use
+AllocationRing* HeapDebugger::ThreadRing()
+{
+	if (thread_ring != nullptr || thread_exited)
+		return thread_ring;
+
+	//take over the ring of a thread that exited, events it still holds are
+	//drained like any other
+	AllocationRing* ring = rings_.load(std::memory_order_acquire);
+	for (; ring != nullptr; ring = ring->next)
+	{
+		bool retired = true;
+		if (ring->retired.load(std::memory_order_relaxed) &&
+			ring->retired.compare_exchange_strong(retired, false, std::memory_order_acq_rel))
+			break;
+	}
+
+	if (ring != nullptr)
+	{
+		thread_retirer.armed = true;
+		thread_ring = ring;
+		return ring;
+	}
+
+	//rings are malloc'ed, creating one must not come back into operator new
+	void* memory = malloc(sizeof(AllocationRing));
+	if (memory == nullptr)
+		return nullptr;
+
+	ring = new (memory) AllocationRing();
+
+	{
+		SpinLockGuard guard(ringsLock_);
+		ring->next = rings_.load(std::memory_order_relaxed);
+		rings_.store(ring, std::memory_order_release);
+	}
+
+	//make sure the ring is retired when the thread exits
+	thread_retirer.armed = true;
+	thread_ring = ring;
+
+	return ring;
+}
+
+//Move every queued allocation into the tables
+void HeapDebugger::DrainEvents()
+{
+	//a free most often misses an allocation its own thread just queued
+	AllocationRing* own = thread_ring;
+	if (own != nullptr && own->Pending() != 0)
+		DrainRing(own);
+
+	//rings with nothing queued are skipped without taking their lock
+	for (AllocationRing* ring = rings_.load(std::memory_order_acquire); ring != nullptr; ring = ring->next)
+	{
+		if (ring != own && ring->Pending() != 0)
+			DrainRing(ring);
+	}
+}
+
+//Move the queued allocations of one ring into the tables
+void HeapDebugger::DrainRing(AllocationRing* ring)
+{
+	//events stay pending until they are tracked, so a thread that finds the
+	//ring pending waits here for the drain that is under way
+	SpinLockGuard guard(ring->drainLock);
+
+	ring->Drain([this](const AllocationEvent& event)
+	{
+		MemoryData data(event.address, event.bytes, event.type);
+		data.returnAddress = event.returnAddress;
+		data.stackId = event.stackId;
+		TrackMemory(data);
+	});
+}
+
+//Body of the background thread of deferred tracking
+void HeapDebugger::ConsumeEvents()
+{
+	while (!stopConsumer_.load(std::memory_order_acquire))
+	{
+		DrainEvents();
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+}
+
+//Entry point of the background thread of deferred tracking
+#if defined (_MSC_VER)
+unsigned long __stdcall HeapDebugger::ConsumerThread(void* heapDebugger)
+{
+	static_cast<HeapDebugger*>(heapDebugger)->ConsumeEvents();
+	return 0;
+}
+#else
+void* HeapDebugger::ConsumerThread(void* heapDebugger)
+{
+	static_cast<HeapDebugger*>(heapDebugger)->ConsumeEvents();
+	return nullptr;
+}
+#endif
+
 //Free associated memory
 void HeapDebugger::FreeMemory(MemoryAddress address, MemoryType type, size_t noBytes, void* ReturnAddr)
 {
@@ -151,74 +1123,172 @@ void HeapDebugger::FreeMemory(MemoryAddress address, MemoryType type, size_t noB
 		return;
 	}
 
-	bool addressFound = false;
-	
-	//loop through memory
-	for (std::list<MemoryData>::iterator it = allocated_list.begin(); it != allocated_list.end(); ++it)
+	Shard& shard = ShardOf(address);
+
+	//the error to report, filled in under the lock and written after it is
+	//released, since writing the CSV allocates
+	MemoryData error(address, noBytes, type);
+
+	shard.lock.Lock();
+
+	//find the address among the current allocations
+	MemoryData* data = shard.allocated.Find(address);
+
+	//the allocation may still be queued in an event ring, so move the
+	//queued allocations into the tables and look again before judging.
+	//Sampled allocations are never queued, so with sampling an address the
+	//slabs or mappings hand out is simply an allocation that was not sampled.
+	if (data == nullptr && rings_.load(std::memory_order_acquire) != nullptr &&
+		!(sampled_.load(std::memory_order_relaxed) && (slabs.Contains(address) || large.Contains(address))))
+	{
+		shard.lock.Unlock();
+		DrainEvents();
+		shard.lock.Lock();
+
+		data = shard.allocated.Find(address);
+	}
+
+	if (data != nullptr)
 	{
-		//find the address
-		if (address == it->address)
+		//determine type of memory to free
+		if (type == data->type)
 		{
-			addressFound = true;
+			//a sized delete must be given the size that was allocated
+			size_t bytes = data->bytes;
+			bool sizeMismatch = noBytes != 0 && noBytes != bytes;
 
-			//determine type of memory to free
-			if (type == it->type)
+			if (sizeMismatch)
 			{
-				//delete the memory if it has notbeen deleted already
-				if (!it->deleted)
-				{
-					it->deleted = true;
-
-					Funcs::FreePageMemory(address, noBytes);
-					
-					return;
-				}
-				else
-				{
-					//this means it was trying to delete memory which was already deleted.
-					printf("Double delete detected at %p, of type %s\n", it->address, it->type == MemoryType::SINGLE_BLOCK ? "Single Block" : "Array");
-					it->errorType = ErrorType::DOUBLE_DELETE;
-					it->returnAddress = ReturnAddr;
-
-					//close the program and break
-					CreateWriteCloseCSV(*it);
-					DEBUG_BREAKPOINT();
-					return;
-				}
+				error = *data;
+				error.errorType = ErrorType::SIZE_MISMATCH;
+				error.deleted = true;
+				error.returnAddress = ReturnAddr;
 			}
 
-			//Types are NOT the same
-			else
+			//remember the allocation as freed, with its error, then delete the
+			//memory once no other thread can find it anymore
+			shard.freed.Push(sizeMismatch ? FreedRecord(error) : FreedRecord(*data));
+			shard.allocated.Erase(address);
+			shard.lock.Unlock();
+
+			if (trace_.IsActive())
+				trace_.Record(TRACE_FREE, address, bytes, ReturnAddr, static_cast<int>(type));
+
+			ReleaseMemory(address, bytes);
+
+			//the memory is still freed, it was found by its address
+			if (sizeMismatch)
 			{
-				//If types aren't the same and the memory is not deleted, then it is a mismatch
-				if (it->deleted == false)
-				{
-					printf("Delete mismatch at %p, of type %s\n", it->address, it->type == MemoryType::SINGLE_BLOCK ? "Single Block" : "Array");
-					it->errorType = ErrorType::NEW_DELETE_MISMATCH;
-					it->returnAddress = ReturnAddr;
-					CreateWriteCloseCSV(*it);
-					DEBUG_BREAKPOINT();
-					return;
-				}
+				printf("Sized delete mismatch at %p, %zu bytes deleted as %zu\n", address, bytes, noBytes);
+				KeepError(error);
+				CreateWriteCloseCSV(error);
+				DEBUG_BREAKPOINT();
 			}
+
+			return;
 		}
+
+		//Types are NOT the same, and the memory is not deleted, so it is a mismatch
+		data->errorType = ErrorType::NEW_DELETE_MISMATCH;
+		data->returnAddress = ReturnAddr;
+		error = *data;
+		shard.lock.Unlock();
+
+		printf("Delete mismatch at %p, of type %s deleted as %s\n", error.address, MemoryTypeName(error.type), MemoryTypeName(type));
+		CreateWriteCloseCSV(error);
+		DEBUG_BREAKPOINT();
+		return;
 	}
 
-	if (addressFound == false)
+	//find the address among the recently freed allocations
+	FreedRecord* record = shard.freed.Find(address);
+
+	//with sampling, the address may have been handed out again to an
+	//allocation that was not sampled, so the record proves nothing
+	if (record != nullptr && sampled_.load(std::memory_order_relaxed))
 	{
-		MemoryData data(address, noBytes, type);
-		data.errorType = ErrorType::NO_HEAP_POINTER;
-		data.deleted = true;
-		data.returnAddress = ReturnAddr;
-	
-		printf("Non heap pointer delete detected at %p\n", address);
-		CreateWriteCloseCSV(data);
+		shard.freed.Erase(address);
+		record = nullptr;
+	}
+
+	if (record != nullptr)
+	{
+		//this means it was trying to delete memory which was already deleted.
+		record->errorType = ErrorType::DOUBLE_DELETE;
+		record->returnAddress = ReturnAddr;
+		error = record->ToMemoryData();
+		shard.lock.Unlock();
+
+		printf("Double delete detected at %p, of type %s\n", error.address, MemoryTypeName(error.type));
 
+		//close the program and break
+		KeepError(error);
+		CreateWriteCloseCSV(error);
 		DEBUG_BREAKPOINT();
 		return;
+	}
+
+	shard.lock.Unlock();
+
+	//with sampling, an unknown address is an allocation that was not sampled
+	if (sampled_.load(std::memory_order_relaxed))
+	{
+		//a slab object cannot hold more than its class, so a sized delete can
+		//still be checked without tracking
+		size_t objectBytes = noBytes != 0 ? slabs.SizeOf(address) : 0;
+		bool sizeMismatch = objectBytes != 0 && noBytes > objectBytes;
+
+		//the slab still knows whether its objects are allocated
+		SlabAllocator::Result result = slabs.Release(address);
+
+		if (result == SlabAllocator::RELEASED || result == SlabAllocator::NOT_SLAB)
+		{
+			if (trace_.IsActive())
+				trace_.Record(TRACE_FREE, address, noBytes, ReturnAddr, static_cast<int>(type));
+
+			if (result == SlabAllocator::NOT_SLAB && !large.Release(address))
+				Funcs::FreePageMemory(address, noBytes);
+
+			if (sizeMismatch)
+			{
+				error.errorType = ErrorType::SIZE_MISMATCH;
+				error.bytes = objectBytes;
+				error.deleted = true;
+				error.returnAddress = ReturnAddr;
+
+				printf("Sized delete mismatch at %p, %zu bytes deleted from a %zu byte object\n", address, noBytes, objectBytes);
+				KeepError(error);
+				CreateWriteCloseCSV(error);
+				DEBUG_BREAKPOINT();
+			}
+
+			return;
+		}
 
+		//a free object of a slab, so it was deleted before
+		if (result == SlabAllocator::ALREADY_FREE)
+		{
+			error.errorType = ErrorType::DOUBLE_DELETE;
+			error.deleted = true;
+			error.returnAddress = ReturnAddr;
+
+			printf("Double delete detected at %p, of type %s\n", address, MemoryTypeName(type));
+			KeepError(error);
+			CreateWriteCloseCSV(error);
+			DEBUG_BREAKPOINT();
+			return;
+		}
 	}
-	
+
+	//the address was never allocated
+	error.errorType = ErrorType::NO_HEAP_POINTER;
+	error.deleted = true;
+	error.returnAddress = ReturnAddr;
+
+	printf("Non heap pointer delete detected at %p\n", address);
+	CreateWriteCloseCSV(error);
+
+	DEBUG_BREAKPOINT();
 }
 
 //Initialize the singleton
@@ -260,11 +1330,10 @@ void* operator new(size_t size)
 {
 	MemoryAddress a = GET_RETURN_ADDR();
 
-	if (size > MAXSIZE)
+	MemoryAddress memory = debugger.AllocateMemory(size);
+	if (memory == nullptr)
 		throw std::bad_alloc();
 
-	MemoryAddress memory = Funcs::PageAlignedAllocate(size);
-
 	MemoryData data(memory, size, MemoryType::SINGLE_BLOCK);
 	data.returnAddress = a;
 
@@ -276,13 +1345,10 @@ void* operator new(size_t size, const std::nothrow_t& ) noexcept
 {
 	MemoryAddress a = GET_RETURN_ADDR();
 
-	if (size > MAXSIZE)
+	MemoryAddress memory = debugger.AllocateMemory(size);
+	if (memory == nullptr)
 		return nullptr;
 
-	
-
-	MemoryAddress memory = Funcs::PageAlignedAllocate(size);
-
 	MemoryData data(memory, size, MemoryType::SINGLE_BLOCK);
 	data.returnAddress = a;
 
@@ -295,11 +1361,10 @@ void* operator new[](size_t size)
 {
 	MemoryAddress a = GET_RETURN_ADDR();
 
-	if (size > MAXSIZE)
+	MemoryAddress memory = debugger.AllocateMemory(size);
+	if (memory == nullptr)
 		throw std::bad_alloc();
 
-	MemoryAddress memory = Funcs::PageAlignedAllocate(size);
-
 	MemoryData data(memory, size, MemoryType::ARRAY);
 	data.returnAddress = a;
 
@@ -312,11 +1377,9 @@ void* operator new[](size_t size, const std::nothrow_t& ) noexcept
 {
 	MemoryAddress a = GET_RETURN_ADDR();
 
-	if (size > MAXSIZE)
+	MemoryAddress memory = debugger.AllocateMemory(size);
+	if (memory == nullptr)
 		return nullptr;
-	
-
-	MemoryAddress memory = Funcs::PageAlignedAllocate(size);
 
 	MemoryData data(memory, size, MemoryType::ARRAY);
 	data.returnAddress = a;
@@ -389,3 +1452,132 @@ void operator delete[](void* address, const std::nothrow_t&) noexcept
 
 	debugger.FreeMemory(address, MemoryType::ARRAY, 0, a);
 }
+
+#if defined (__cpp_aligned_new)
+//====================================================================================================
+//Below are the ALIGNED new and delete overloads of C++17, used for types aligned above the default
+
+void* operator new(size_t size, std::align_val_t alignment)
+{
+	MemoryAddress a = GET_RETURN_ADDR();
+
+	MemoryAddress memory = debugger.AllocateAlignedMemory(size, static_cast<size_t>(alignment));
+	if (memory == nullptr)
+		throw std::bad_alloc();
+
+	MemoryData data(memory, size, MemoryType::ALIGNED_SINGLE_BLOCK);
+	data.returnAddress = a;
+
+	debugger.ObserveMemory(data);
+
+	return memory;
+}
+
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t& ) noexcept
+{
+	MemoryAddress a = GET_RETURN_ADDR();
+
+	MemoryAddress memory = debugger.AllocateAlignedMemory(size, static_cast<size_t>(alignment));
+	if (memory == nullptr)
+		return nullptr;
+
+	MemoryData data(memory, size, MemoryType::ALIGNED_SINGLE_BLOCK);
+	data.returnAddress = a;
+
+	debugger.ObserveMemory(data);
+
+	return memory;
+}
+
+void* operator new[](size_t size, std::align_val_t alignment)
+{
+	MemoryAddress a = GET_RETURN_ADDR();
+
+	MemoryAddress memory = debugger.AllocateAlignedMemory(size, static_cast<size_t>(alignment));
+	if (memory == nullptr)
+		throw std::bad_alloc();
+
+	MemoryData data(memory, size, MemoryType::ALIGNED_ARRAY);
+	data.returnAddress = a;
+
+	debugger.ObserveMemory(data);
+
+	return memory;
+}
+
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t& ) noexcept
+{
+	MemoryAddress a = GET_RETURN_ADDR();
+
+	MemoryAddress memory = debugger.AllocateAlignedMemory(size, static_cast<size_t>(alignment));
+	if (memory == nullptr)
+		return nullptr;
+
+	MemoryData data(memory, size, MemoryType::ALIGNED_ARRAY);
+	data.returnAddress = a;
+
+	debugger.ObserveMemory(data);
+
+	return memory;
+}
+
+void operator delete(void* address, std::align_val_t) noexcept
+{
+	MemoryAddress a = GET_RETURN_ADDR();
+
+	if (address == 0)
+		return;
+
+	debugger.FreeMemory(address, MemoryType::ALIGNED_SINGLE_BLOCK, 0, a);
+}
+
+void operator delete(void* address, size_t size, std::align_val_t) noexcept
+{
+	MemoryAddress a = GET_RETURN_ADDR();
+
+	if (address == 0)
+		return;
+
+	debugger.FreeMemory(address, MemoryType::ALIGNED_SINGLE_BLOCK, size, a);
+}
+
+void operator delete(void* address, std::align_val_t, const std::nothrow_t&) noexcept
+{
+	MemoryAddress a = GET_RETURN_ADDR();
+
+	if (address == 0)
+		return;
+
+	debugger.FreeMemory(address, MemoryType::ALIGNED_SINGLE_BLOCK, 0, a);
+}
+
+void operator delete[](void* address, std::align_val_t) noexcept
+{
+	MemoryAddress a = GET_RETURN_ADDR();
+
+	if (address == 0)
+		return;
+
+	debugger.FreeMemory(address, MemoryType::ALIGNED_ARRAY, 0, a);
+}
+
+void operator delete[](void* address, size_t size, std::align_val_t) noexcept
+{
+	MemoryAddress a = GET_RETURN_ADDR();
+
+	if (address == 0)
+		return;
+
+	debugger.FreeMemory(address, MemoryType::ALIGNED_ARRAY, size, a);
+}
+
+void operator delete[](void* address, std::align_val_t, const std::nothrow_t&) noexcept
+{
+	MemoryAddress a = GET_RETURN_ADDR();
+
+	if (address == 0)
+		return;
+
+	debugger.FreeMemory(address, MemoryType::ALIGNED_ARRAY, 0, a);
+}
+#endif
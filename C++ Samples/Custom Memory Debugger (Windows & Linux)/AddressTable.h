@@ -0,0 +1,186 @@
+/*
+* ==============================================================
+* File   : AddressTable.h
+* Purpose: Open addressing hash table keyed by memory address,
+		   used by the heap debugger to find allocations in O(1)
+  Author : Rohit Saini
+* Date   : 11/2022
+* All code is Copyrighted to owner, Rohit Saini
+* ==============================================================
+*/
+
+#ifndef ADDRESSTABLE_H
+#define ADDRESSTABLE_H
+
+#include <cstdlib>      //malloc and free, the table must never call operator new
+#include <cstring>      //memset
+#include <cstdint>      //uint64_t
+#include <type_traits>  //is_trivially_copyable
+
+//Linear probing hash table. Entries are stored by value in one flat array
+//and are keyed by their 'address' member, a null address marks an empty slot.
+template<typename Entry>
+class AddressTable
+{
+public:
+	AddressTable() : slots_(nullptr), capacity_(0), size_(0) {}
+	~AddressTable() { Clear(); }
+
+	//Find the entry of an address, nullptr if it is not in the table
+	Entry* Find(void* address) const
+	{
+		if (size_ == 0)
+			return nullptr;
+
+		//walk the probe sequence until the address or an empty slot
+		for (size_t i = Home(address); ; i = (i + 1) & (capacity_ - 1))
+		{
+			if (slots_[i].address == address)
+				return &slots_[i];
+			if (slots_[i].address == nullptr)
+				return nullptr;
+		}
+	}
+
+	//Add an entry, replacing the entry with the same address if there is one.
+	//Returns nullptr if the table could not grow.
+	Entry* Insert(const Entry& entry)
+	{
+		//keep the load below 70% so probe sequences stay short
+		if ((size_ + 1) * 10 > capacity_ * 7 && !Grow())
+			return nullptr;
+
+		size_t i = Home(entry.address);
+		while (slots_[i].address != nullptr && slots_[i].address != entry.address)
+			i = (i + 1) & (capacity_ - 1);
+
+		if (slots_[i].address == nullptr)
+			size_++;
+
+		slots_[i] = entry;
+		return &slots_[i];
+	}
+
+	//Remove the entry of an address, false if it is not in the table
+	bool Erase(void* address)
+	{
+		Entry* entry = Find(address);
+		if (entry == nullptr)
+			return false;
+
+		//backward shift deletion, move later entries of the same probe run
+		//into the hole so no tombstones are needed
+		size_t mask = capacity_ - 1;
+		size_t hole = entry - slots_;
+
+		for (size_t i = (hole + 1) & mask; slots_[i].address != nullptr; i = (i + 1) & mask)
+		{
+			size_t home = Home(slots_[i].address);
+
+			//the entry can move if its home is not between the hole and its slot
+			if (((i - home) & mask) >= ((i - hole) & mask))
+			{
+				slots_[hole] = slots_[i];
+				hole = i;
+			}
+		}
+
+		slots_[hole].address = nullptr;
+		size_--;
+		return true;
+	}
+
+	//Free the slots, the table can still be used afterwards
+	void Clear()
+	{
+		free(slots_);
+		slots_ = nullptr;
+		capacity_ = 0;
+		size_ = 0;
+	}
+
+	//Number of entries
+	size_t Size() const { return size_; }
+
+	//Call func on every entry, func must not insert or erase
+	template<typename Func>
+	void ForEach(Func func)
+	{
+		for (size_t i = 0; i < capacity_; i++)
+			if (slots_[i].address != nullptr)
+				func(slots_[i]);
+	}
+
+	//Call func on the entries of 'count' slots from 'first', so a table can be
+	//walked in steps with a lock released in between. Returns the slot to go
+	//on from, 0 once the end is reached. Entries moved by inserts and erases
+	//between steps may be missed or seen twice.
+	template<typename Func>
+	size_t ForEachInRange(size_t first, size_t count, Func func)
+	{
+		size_t last = first + count < capacity_ ? first + count : capacity_;
+
+		for (size_t i = first; i < last; i++)
+			if (slots_[i].address != nullptr)
+				func(slots_[i]);
+
+		return last < capacity_ ? last : 0;
+	}
+
+private:
+	static_assert(std::is_trivially_copyable<Entry>::value, "entries are moved with plain copies");
+
+	//Slot an address hashes to, allocations are aligned so the low bits are mixed in
+	size_t Home(void* address) const
+	{
+		uint64_t key = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(address));
+		key ^= key >> 33;
+		key *= 0xff51afd7ed558ccdULL;
+		key ^= key >> 33;
+		return static_cast<size_t>(key) & (capacity_ - 1);
+	}
+
+	//Double the capacity and reinsert every entry
+	bool Grow()
+	{
+		size_t capacity = capacity_ ? capacity_ * 2 : 1024;
+
+		//zeroed memory is a table of empty slots
+		Entry* slots = static_cast<Entry*>(calloc(capacity, sizeof(Entry)));
+		if (slots == nullptr)
+			return false;
+
+		Entry* old = slots_;
+		size_t oldCapacity = capacity_;
+
+		slots_ = slots;
+		capacity_ = capacity;
+
+		for (size_t i = 0; i < oldCapacity; i++)
+		{
+			if (old[i].address == nullptr)
+				continue;
+
+			size_t j = Home(old[i].address);
+			while (slots_[j].address != nullptr)
+				j = (j + 1) & (capacity_ - 1);
+			slots_[j] = old[i];
+		}
+
+		free(old);
+		return true;
+	}
+
+	//Disable copying, the table owns its slots
+	AddressTable(const AddressTable&);
+	AddressTable& operator=(const AddressTable&);
+
+	//Slot array, allocated with calloc
+	Entry* slots_;
+	//Number of slots, always a power of two
+	size_t capacity_;
+	//Number of entries
+	size_t size_;
+};
+
+#endif // ADDRESSTABLE_H
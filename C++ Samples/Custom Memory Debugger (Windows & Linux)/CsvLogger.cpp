@@ -0,0 +1,235 @@
+/*
+* ==============================================================
+* File   : CsvLogger.cpp
+* Purpose: Buffered log file for the heap debugger, records are
+		   collected in memory and written by a background thread
+  Author : Rohit Saini
+* Date   : 11/2022
+* All code is Copyrighted to owner, Rohit Saini
+* ==============================================================
+*/
+
+#include "CsvLogger.h"
+
+#include <cstdlib>   //malloc, the buffers must not come from operator new
+#include <cstring>   //memcpy, strlen
+#include <chrono>
+
+#if defined (_MSC_VER)
+#include <windows.h>
+#endif
+
+//How often the writer thread writes a partly filled buffer
+static const std::chrono::milliseconds FLUSH_INTERVAL(100);
+
+CsvLogger::CsvLogger() :
+	file_(nullptr), active_(nullptr), used_(0), full_(nullptr), fullBytes_(0), spare_(nullptr), stop_(false)
+{
+
+}
+
+CsvLogger::~CsvLogger()
+{
+	Close();
+}
+
+//Create or truncate the file and start the writer thread
+bool CsvLogger::Open(const char* path, const char* header)
+{
+	std::unique_lock<std::mutex> lock(lock_);
+
+	if (file_ != nullptr)
+		return true;
+
+	#if defined (_MSC_VER)
+		if (fopen_s(&file_, path, "wb") != 0)
+			file_ = nullptr;
+	#else
+		file_ = fopen(path, "wb");
+	#endif
+
+	if (file_ == nullptr)
+		return false;
+
+	active_ = static_cast<char*>(malloc(BUFFER_SIZE));
+	spare_ = static_cast<char*>(malloc(BUFFER_SIZE));
+
+	if (active_ == nullptr || spare_ == nullptr)
+	{
+		free(active_); free(spare_);
+		active_ = spare_ = nullptr;
+		fclose(file_); file_ = nullptr;
+		return false;
+	}
+
+	used_ = 0;
+	full_ = nullptr;
+	stop_ = false;
+
+	//the header goes in front of the first buffer
+	size_t length = strlen(header);
+	memcpy(active_, header, length < BUFFER_SIZE ? length : BUFFER_SIZE);
+	used_ = length < BUFFER_SIZE ? length : BUFFER_SIZE;
+
+	lock.unlock();
+
+	#if defined (_MSC_VER)
+		writer_ = CreateThread(nullptr, 0, &CsvLogger::WriterThread, this, 0, nullptr);
+		bool started = writer_ != nullptr;
+	#else
+		bool started = pthread_create(&writer_, nullptr, &CsvLogger::WriterThread, this) == 0;
+	#endif
+
+	//no writer thread, give up on the file
+	if (!started)
+	{
+		lock.lock();
+		fclose(file_); file_ = nullptr;
+		free(active_); free(spare_);
+		active_ = spare_ = nullptr;
+		used_ = 0;
+		return false;
+	}
+
+	return true;
+}
+
+//Append text to the active buffer
+void CsvLogger::Write(const char* text, size_t length)
+{
+	std::unique_lock<std::mutex> lock(lock_);
+
+	if (file_ == nullptr)
+		return;
+
+	//longer text than a whole buffer is cut, records are single short lines
+	if (length > BUFFER_SIZE)
+		length = BUFFER_SIZE;
+
+	if (used_ + length > BUFFER_SIZE)
+		SwapBuffers(lock);
+
+	memcpy(active_ + used_, text, length);
+	used_ += length;
+}
+
+//Block until everything written so far is in the file
+void CsvLogger::Flush()
+{
+	std::unique_lock<std::mutex> lock(lock_);
+
+	if (file_ == nullptr)
+		return;
+
+	if (used_ > 0)
+		SwapBuffers(lock);
+
+	written_.wait(lock, [this] { return full_ == nullptr; });
+}
+
+//Write everything that is left and close the file
+void CsvLogger::Close()
+{
+	{
+		std::lock_guard<std::mutex> lock(lock_);
+
+		if (file_ == nullptr)
+			return;
+
+		stop_ = true;
+	}
+
+	//the writer thread empties both buffers before it exits
+	wake_.notify_one();
+
+	#if defined (_MSC_VER)
+		WaitForSingleObject(writer_, INFINITE);
+		CloseHandle(writer_);
+	#else
+		pthread_join(writer_, nullptr);
+	#endif
+
+	std::lock_guard<std::mutex> lock(lock_);
+
+	//text written after the writer thread stopped
+	if (used_ > 0)
+		fwrite(active_, 1, used_, file_);
+
+	fclose(file_);
+	free(active_);
+	free(spare_);
+
+	file_ = nullptr;
+	active_ = spare_ = nullptr;
+	used_ = 0;
+}
+
+//Hand the active buffer to the writer thread and continue in the spare one
+void CsvLogger::SwapBuffers(std::unique_lock<std::mutex>& lock)
+{
+	//the spare buffer is back once the writer is done with the last full one
+	written_.wait(lock, [this] { return full_ == nullptr; });
+
+	full_ = active_;
+	fullBytes_ = used_;
+	active_ = spare_;
+	spare_ = nullptr;
+	used_ = 0;
+
+	wake_.notify_one();
+}
+
+//Entry point of the writer thread
+#if defined (_MSC_VER)
+unsigned long __stdcall CsvLogger::WriterThread(void* logger)
+{
+	static_cast<CsvLogger*>(logger)->WriteLoop();
+	return 0;
+}
+#else
+void* CsvLogger::WriterThread(void* logger)
+{
+	static_cast<CsvLogger*>(logger)->WriteLoop();
+	return nullptr;
+}
+#endif
+
+//Write full buffers as they come, and the active one every FLUSH_INTERVAL
+void CsvLogger::WriteLoop()
+{
+	std::unique_lock<std::mutex> lock(lock_);
+
+	for (;;)
+	{
+		wake_.wait_for(lock, FLUSH_INTERVAL, [this] { return full_ != nullptr || stop_; });
+
+		//nothing full yet, write what there is so the file is never far behind
+		if (full_ == nullptr && used_ > 0)
+		{
+			full_ = active_;
+			fullBytes_ = used_;
+			active_ = spare_;
+			spare_ = nullptr;
+			used_ = 0;
+		}
+
+		if (full_ != nullptr)
+		{
+			char* buffer = full_;
+			size_t bytes = fullBytes_;
+
+			//one large sequential write, without blocking the writers
+			lock.unlock();
+			fwrite(buffer, 1, bytes, file_);
+			fflush(file_);
+			lock.lock();
+
+			spare_ = buffer;
+			full_ = nullptr;
+			written_.notify_all();
+		}
+
+		if (stop_ && used_ == 0)
+			return;
+	}
+}
@@ -0,0 +1,91 @@
+/*
+* ==============================================================
+* File   : CsvLogger.h
+* Purpose: Buffered log file for the heap debugger, records are
+		   collected in memory and written by a background thread
+  Author : Rohit Saini
+* Date   : 11/2022
+* All code is Copyrighted to owner, Rohit Saini
+* ==============================================================
+*/
+
+#ifndef CSVLOGGER_H
+#define CSVLOGGER_H
+
+#include <cstdio>               //FILE
+#include <mutex>
+#include <condition_variable>
+
+//the writer thread is a native thread, std::thread would allocate its state
+//with operator new and the debugger would see it as a leak
+#if !defined (_MSC_VER)
+#include <pthread.h>
+#endif
+
+//Keeps one file open and appends lines to a large in-memory buffer. When the
+//buffer fills up it is swapped with a second one and a background thread
+//writes it out in one go, so callers only ever pay for a memcpy.
+class CsvLogger
+{
+public:
+	//Size of each of the two buffers
+	static const size_t BUFFER_SIZE = 1 << 20;
+
+	CsvLogger();
+	~CsvLogger();
+
+	//Create or truncate the file, write the header line and start the writer thread
+	bool Open(const char* path, const char* header);
+	//Append text to the buffer, it reaches the file later
+	void Write(const char* text, size_t length);
+	//Block until everything written so far is in the file
+	void Flush();
+	//Write everything that is left, stop the writer thread and close the file
+	void Close();
+
+	//Whether the file is open
+	bool IsOpen() const { return file_ != nullptr; }
+
+private:
+	//Hand the active buffer to the writer thread, the lock must be held
+	void SwapBuffers(std::unique_lock<std::mutex>& lock);
+	//Body of the writer thread
+	void WriteLoop();
+	//Entry point of the writer thread
+	#if defined (_MSC_VER)
+	static unsigned long __stdcall WriterThread(void* logger);
+	#else
+	static void* WriterThread(void* logger);
+	#endif
+
+	//Disable copying
+	CsvLogger(const CsvLogger&);
+	CsvLogger& operator=(const CsvLogger&);
+
+	//The open file
+	FILE* file_;
+	//Buffer being filled, and the number of bytes in it
+	char* active_;
+	size_t used_;
+	//Buffer waiting to be written, nullptr if there is none
+	char* full_;
+	size_t fullBytes_;
+	//Empty buffer, nullptr while the writer thread has it
+	char* spare_;
+
+	//Guards the buffers
+	std::mutex lock_;
+	//Wakes the writer thread
+	std::condition_variable wake_;
+	//Signals that the writer thread is done with a buffer
+	std::condition_variable written_;
+	//The writer thread, and its stop flag
+	#if defined (_MSC_VER)
+	void* writer_;
+	#else
+	pthread_t writer_;
+	#endif
+	bool stop_;
+};
+
+#endif // CSVLOGGER_H
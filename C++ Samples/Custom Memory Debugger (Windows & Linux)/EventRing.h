@@ -0,0 +1,89 @@
+/*
+* ==============================================================
+* File   : EventRing.h
+* Purpose: Per thread ring of allocation events, filled by operator
+		   new and drained into the heap debugger by another thread
+  Author : Rohit Saini
+* Date   : 11/2022
+* All code is Copyrighted to owner, Rohit Saini
+* ==============================================================
+*/
+
+#ifndef EVENTRING_H
+#define EVENTRING_H
+
+#include "SpinLock.h"
+
+#include <atomic>   //atomic
+#include <cstddef>  //size_t
+
+//Lock-free single producer single consumer ring of Capacity events, which
+//must be a power of two. The producer is the thread that owns the ring, the
+//consumer is whichever thread holds the ring's drain lock. Rings are
+//placed in malloc'ed memory so they never call operator new.
+template<typename Event, size_t Capacity>
+class EventRing
+{
+public:
+	EventRing() : next(nullptr), retired(false), drainLock(), head_(0), tail_(0) {}
+
+	//Append an event, false if the ring is full (owning thread only)
+	bool Push(const Event& event)
+	{
+		size_t tail = tail_.load(std::memory_order_relaxed);
+
+		if (tail - head_.load(std::memory_order_acquire) == Capacity)
+			return false;
+
+		events_[tail & (Capacity - 1)] = event;
+		tail_.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	//Pass every queued event to func in order, returns how many (consumer only)
+	template<typename Func>
+	size_t Drain(Func func)
+	{
+		size_t head = head_.load(std::memory_order_relaxed);
+		size_t tail = tail_.load(std::memory_order_acquire);
+
+		for (size_t i = head; i != tail; i++)
+			func(events_[i & (Capacity - 1)]);
+
+		//hand the slots back to the producer
+		head_.store(tail, std::memory_order_release);
+		return tail - head;
+	}
+
+	//Number of queued events, any thread may ask. Events stay counted until
+	//the consumer has passed them on.
+	size_t Pending() const
+	{
+		return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+	}
+
+	//Next ring in the debugger's list of rings
+	EventRing* next;
+	//Set when the owning thread exits, a new thread may then take the ring over
+	std::atomic<bool> retired;
+	//Held while the ring is drained, makes the holder the consumer
+	SpinLock drainLock;
+
+private:
+	//Disable copying
+	EventRing(const EventRing&);
+	EventRing& operator=(const EventRing&);
+
+	//Next event to read, owned by the consumer
+	std::atomic<size_t> head_;
+	//Keeps the two positions on separate cache lines, padding is used instead
+	//of alignas because malloc'ed memory is not cache line aligned
+	char padding_[64 - sizeof(std::atomic<size_t>)];
+	//Next event to write, owned by the producer
+	std::atomic<size_t> tail_;
+	char tailPadding_[64 - sizeof(std::atomic<size_t>)];
+	//The events
+	Event events_[Capacity];
+};
+
+#endif // EVENTRING_H
@@ -0,0 +1,121 @@
+/*
+* ==============================================================
+* File   : FreedRing.h
+* Purpose: Fixed size ring of the most recently freed allocations,
+		   used by the heap debugger to detect double deletes
+  Author : Rohit Saini
+* Date   : 11/2022
+* All code is Copyrighted to owner, Rohit Saini
+* ==============================================================
+*/
+
+#ifndef FREEDRING_H
+#define FREEDRING_H
+
+#include "AddressTable.h"
+
+//Keeps the last 'capacity' freed records. When the ring is full the oldest
+//record is evicted, so memory stays bounded no matter how long the program
+//runs. An address table maps each address to its slot in the ring.
+template<typename Record>
+class FreedRing
+{
+public:
+	FreedRing(size_t capacity) : records_(nullptr), capacity_(capacity), next_(0) {}
+	~FreedRing() { Clear(); }
+
+	//Find the record of an address, nullptr if it is not retained
+	Record* Find(void* address) const
+	{
+		Index* index = index_.Find(address);
+		return index ? &records_[index->slot] : nullptr;
+	}
+
+	//Add a record, evicting the oldest one if the ring is full
+	void Push(const Record& record)
+	{
+		if (capacity_ == 0)
+			return;
+
+		if (records_ == nullptr)
+		{
+			records_ = static_cast<Record*>(calloc(capacity_, sizeof(Record)));
+			if (records_ == nullptr)
+				return;
+		}
+
+		size_t slot = next_;
+		next_ = (next_ + 1) % capacity_;
+
+		//evict the old record, unless its address was freed again since
+		Evict(slot);
+
+		records_[slot] = record;
+
+		Index index;
+		index.address = record.address;
+		index.slot = slot;
+		index_.Insert(index);
+	}
+
+	//Forget the record of an address, when the address is allocated again
+	void Erase(void* address)
+	{
+		index_.Erase(address);
+	}
+
+	//Free the records, the ring can still be used afterwards
+	void Clear()
+	{
+		index_.Clear();
+		free(records_);
+		records_ = nullptr;
+		next_ = 0;
+	}
+
+	//Number of retained records
+	size_t Size() const { return index_.Size(); }
+
+	//Call func on every retained record, func must not push or erase
+	template<typename Func>
+	void ForEach(Func func)
+	{
+		Record* records = records_;
+		index_.ForEach([records, &func](Index& index) { func(records[index.slot]); });
+	}
+
+private:
+	//Slot of a retained address
+	struct Index
+	{
+		void* address;
+		size_t slot;
+	};
+
+	//Remove the record in a slot from the index, if the index still points at it
+	void Evict(size_t slot)
+	{
+		void* old = records_[slot].address;
+		if (old == nullptr)
+			return;
+
+		Index* index = index_.Find(old);
+		if (index != nullptr && index->slot == slot)
+			index_.Erase(old);
+	}
+
+	//Disable copying, the ring owns its records
+	FreedRing(const FreedRing&);
+	FreedRing& operator=(const FreedRing&);
+
+	//Address to slot lookup
+	AddressTable<Index> index_;
+	//Ring of records, allocated with calloc on the first push
+	Record* records_;
+	//Number of records in the ring
+	size_t capacity_;
+	//Slot the next record goes to
+	size_t next_;
+};
+
+#endif // FREEDRING_H
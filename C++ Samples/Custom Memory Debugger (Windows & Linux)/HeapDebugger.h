@@ -15,20 +15,79 @@
 //This file is not included, since this is a sample
 #include "Common.h"
 
-//Standard C++ list and file stream
-#include <list>
-#include <fstream>
+//Log file, the address tables and locks
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include "AddressTable.h"
+#include "FreedRing.h"
+#include "SpinLock.h"
+#include "EventRing.h"
+#include "CsvLogger.h"
+#include "TraceWriter.h"
+#include "SymbolCache.h"
+#include "StackDepot.h"
 
 typedef void* MemoryAddress;
 
+//Number of freed allocations remembered to detect double deletes,
+//older ones are forgotten so memory use stays bounded
+#ifndef HEAPDEBUGGER_FREED_RECORDS
+#define HEAPDEBUGGER_FREED_RECORDS 65536
+#endif
 
-//store type of allocation
+//Number of double and sized delete errors kept for the report at exit,
+//later ones are only written when they happen
+#ifndef HEAPDEBUGGER_KEPT_ERRORS
+#define HEAPDEBUGGER_KEPT_ERRORS 4096
+#endif
+
+//Number of address shards, each has its own lock and tables so threads
+//allocating at the same time rarely wait for each other
+#ifndef HEAPDEBUGGER_SHARDS
+#define HEAPDEBUGGER_SHARDS 64
+#endif
+
+//Number of allocation events each thread can queue with deferred tracking
+#ifndef HEAPDEBUGGER_EVENT_RING_SIZE
+#define HEAPDEBUGGER_EVENT_RING_SIZE 1024
+#endif
+
+//Allocations larger than this are mapped from the system one by one, and
+//unmapped as soon as they are freed
+#ifndef HEAPDEBUGGER_LARGE_BYTES
+#define HEAPDEBUGGER_LARGE_BYTES (1024 * 1024)
+#endif
+
+//Number of frames kept of each allocation's call stack, 0 keeps only the
+//return address of operator new
+#ifndef HEAPDEBUGGER_STACK_DEPTH
+#define HEAPDEBUGGER_STACK_DEPTH 16
+#endif
+
+
+//store type of allocation, the aligned forms of new and delete of C++17
+//are types of their own so mixing them up is a mismatch
 enum class MemoryType
 {
 	SINGLE_BLOCK = 0,
-	ARRAY = 1
+	ARRAY = 1,
+	ALIGNED_SINGLE_BLOCK = 2,
+	ALIGNED_ARRAY = 3
 };
 
+//name of a type of allocation, for reports
+inline const char* MemoryTypeName(MemoryType type)
+{
+	switch (type)
+	{
+	case MemoryType::ARRAY: return "Array";
+	case MemoryType::ALIGNED_SINGLE_BLOCK: return "Aligned Single Block";
+	case MemoryType::ALIGNED_ARRAY: return "Aligned Array";
+	default: return "Single Block";
+	}
+}
+
 //store types of errors and leaks possible during memory allocation
 enum class ErrorType
 {
@@ -36,7 +95,9 @@ enum class ErrorType
 	LEAK = 1,
 	DOUBLE_DELETE = 2,
 	NO_HEAP_POINTER = 3,
-	NEW_DELETE_MISMATCH = 4
+	NEW_DELETE_MISMATCH = 4,
+	OUTSTANDING = 5,
+	SIZE_MISMATCH = 6
 };
 
 //store each memory allocation's information
@@ -51,8 +112,14 @@ public:
 
 	bool deleted;
 
+	//call stack of the allocation in the stack depot
+	uint32_t stackId;
+
 	MemoryAddress returnAddress;
 
+	//epoch the allocation was tracked in, see HeapDebugger::AdvanceEpoch
+	uint32_t epoch;
+
 	MemoryData()
 	{
 		address = nullptr;
@@ -60,22 +127,73 @@ public:
 		type = MemoryType::SINGLE_BLOCK;
 		errorType = ErrorType::NONE;
 		deleted = false;
+		stackId = StackDepot::NO_STACK;
 		returnAddress = 0;
+		epoch = 0;
 	}
 
 	MemoryData(MemoryAddress add, size_t size, MemoryType memoryType) :
 		address(add), bytes(size), type(memoryType), errorType(ErrorType::NONE), deleted(false),
-		returnAddress(0)
+		stackId(StackDepot::NO_STACK), returnAddress(0), epoch(0)
 	{
 
 	}
 };
 
-//for storing pointers
-namespace Storage {
-	template<typename T>
-	using list = std::list<T, Mallocator<T>>;
-}
+//compact record of a freed allocation, kept to detect double deletes
+struct FreedRecord
+{
+public:
+	MemoryAddress address;
+	size_t bytes;
+	MemoryAddress returnAddress;
+
+	MemoryType type;
+	ErrorType errorType;
+	uint32_t stackId;
+
+	FreedRecord()
+	{
+		address = nullptr;
+		bytes = 0;
+		returnAddress = 0;
+		type = MemoryType::SINGLE_BLOCK;
+		errorType = ErrorType::NONE;
+		stackId = StackDepot::NO_STACK;
+	}
+
+	FreedRecord(const MemoryData& data) :
+		address(data.address), bytes(data.bytes), returnAddress(data.returnAddress), type(data.type),
+		errorType(data.errorType), stackId(data.stackId)
+	{
+
+	}
+
+	//full memory data of the record, for reporting
+	MemoryData ToMemoryData() const
+	{
+		MemoryData data(address, bytes, type);
+		data.errorType = errorType;
+		data.deleted = true;
+		data.stackId = stackId;
+		data.returnAddress = returnAddress;
+		return data;
+	}
+};
+
+//compact record of one allocation, queued by operator new with deferred tracking
+struct AllocationEvent
+{
+public:
+	MemoryAddress address;
+	size_t bytes;
+	MemoryAddress returnAddress;
+	MemoryType type;
+	uint32_t stackId;
+};
+
+//ring of allocation events of one thread
+typedef EventRing<AllocationEvent, HEAPDEBUGGER_EVENT_RING_SIZE> AllocationRing;
 
 //structure of the actual memory debuffer
 struct HeapDebugger {
@@ -83,10 +201,68 @@ public:
 	HeapDebugger();
 	~HeapDebugger();
 
+	//Memory for operator new, from size class slabs, or from a page of its own
+	//in guard page mode. Large allocations get a mapping of their own.
+	//Returns nullptr if the system is out of memory.
+	MemoryAddress AllocateMemory(size_t size);
+	//Memory for the aligned forms of operator new, nullptr if the system is
+	//out of memory
+	MemoryAddress AllocateAlignedMemory(size_t size, size_t alignment);
+
+	//Give every allocation its own pages, so overflows hit a guard page. Off by
+	//default, unless HEAPDEBUGGER_GUARD_PAGES is set.
+	void SetGuardPages(bool enabled);
+
+	//Back large allocations of 2 MB and more with huge pages when the system
+	//allows it. Off by default, unless HEAPDEBUGGER_HUGE_PAGES is set.
+	void SetHugePages(bool enabled);
+
 	//Functions to observe and free associated memory
 	void ObserveMemory(MemoryData data);
 	void FreeMemory(MemoryAddress address, MemoryType type, size_t noBytes, void* ReturnAddr);
 
+	//When enabled, operator new only queues its allocations in a ring of the
+	//calling thread and a background thread moves them into the tables.
+	//Deletes are still checked right away.
+	void SetDeferredTracking(bool enabled);
+
+	//Record every allocation and free in a binary trace file with room for
+	//maxRecords records, see TraceFormat.h and the TraceConvert tool
+	bool StartTrace(const char* path, size_t maxRecords);
+	void StopTrace();
+
+	//Track on average one allocation per 'bytes' allocated bytes, picked
+	//with a random geometric interval, and skip all others. 0 tracks every
+	//allocation, which is the default unless HEAPDEBUGGER_SAMPLE_BYTES is set.
+	//Once sampling was used, deleting an unknown address is not an error.
+	void SetSampleInterval(size_t bytes);
+	//Number of allocations a sampled allocation of 'bytes' bytes stands for
+	double SampleWeight(size_t bytes) const;
+
+	//Write the live allocations and every allocation made so far, grouped by
+	//call stack, as a gperftools text heap profile that pprof can read
+	bool WriteHeapProfile(const char* path);
+	//Write a profile named '<prefix>.<pid>.<n>.heap' every time the process
+	//gets SIGUSR2, from a thread of its own. Linux only. Also turned on by
+	//setting HEAPDEBUGGER_HEAP_PROFILE to the prefix.
+	bool StartProfileSignal(const char* prefix);
+	void StopProfileSignal();
+
+	//Every allocation remembers the epoch it was made in. Epochs only change
+	//when AdvanceEpoch is called, which returns the new epoch.
+	uint32_t CurrentEpoch() const;
+	uint32_t AdvanceEpoch();
+	//Write every live allocation made in 'sinceEpoch' or later to
+	//OutstandingLog.csv and return how many there were. The shards are read
+	//a few slots at a time, so allocating threads are never held up long.
+	size_t ReportOutstanding(uint32_t sinceEpoch);
+	//Start a thread that advances the epoch every 'periodMs' milliseconds and
+	//reports the live allocations that have lived through 'ageEpochs' whole
+	//epochs, each epoch once. Also turned on by setting HEAPDEBUGGER_REPORT_MS
+	//to the period.
+	bool StartReporter(unsigned int periodMs, uint32_t ageEpochs);
+	void StopReporter();
+
 	//File logging functions to CSV file
 	void CreateCSV();
 	void WriteCSV(MemoryData data);
@@ -94,14 +270,148 @@ public:
 	void CreateWriteCloseCSV(MemoryData data);
 
 private:
-	//All current allocations
-	Storage::list<MemoryData> allocated_list;
-	//CSV file pointer
-	std::ofstream file_;
+	//Tracking tables of the addresses that hash to one shard
+	struct alignas(64) Shard
+	{
+		Shard() : freed(HEAPDEBUGGER_FREED_RECORDS / HEAPDEBUGGER_SHARDS) {}
+
+		//Guards both tables
+		SpinLock lock;
+		//All current allocations, keyed by address
+		AddressTable<MemoryData> allocated;
+		//The most recently freed allocations
+		FreedRing<FreedRecord> freed;
+	};
+
+	//Shard that tracks an address
+	Shard& ShardOf(MemoryAddress address);
+
+	//Add an allocation to its shard
+	void TrackMemory(const MemoryData& data);
+
+	//Intern the calling thread's stack, from the caller of operator new at 'returnAddress'
+	uint32_t CaptureStack(MemoryAddress returnAddress);
+	//Text of a stack for the CSV, resolved through the symbol cache, the CSV lock must be held
+	void FormatStack(uint32_t stackId, char* text, size_t size);
+	//One CSV line of an allocation, returns its length, the CSV lock must be held
+	int FormatCSV(const MemoryData& data, char* text, size_t size);
+
+	//Report the live allocations of epochs 'first' to 'last'
+	size_t ReportEpochs(uint32_t first, uint32_t last);
+	//Body of the reporter thread
+	void ReportLoop();
+	//Entry point of the reporter thread
+	#if defined (_MSC_VER)
+	static unsigned long __stdcall ReporterThread(void* heapDebugger);
+	#else
+	static void* ReporterThread(void* heapDebugger);
+	#endif
+
+	//Return memory to the slabs or the pages it came from
+	void ReleaseMemory(MemoryAddress address, size_t noBytes);
+
+	//Keep an error of freed memory for the report at exit
+	void KeepError(const MemoryData& error);
+
+	//Whether the calling thread's next allocation of 'bytes' bytes is sampled
+	bool SampleAllocation(size_t bytes);
+
+	//Queue an allocation in the calling thread's ring, false if it has to be tracked now
+	bool QueueMemory(const MemoryData& data);
+	//Ring of the calling thread, created on first use
+	AllocationRing* ThreadRing();
+	//Move every queued allocation into the tables, the calling thread's first
+	void DrainEvents();
+	//Move the queued allocations of one ring into the tables
+	void DrainRing(AllocationRing* ring);
+	//Body of the background thread of deferred tracking
+	void ConsumeEvents();
+	//Entry point of the background thread of deferred tracking
+	#if defined (_MSC_VER)
+	static unsigned long __stdcall ConsumerThread(void* heapDebugger);
+	#else
+	static void* ConsumerThread(void* heapDebugger);
+	#endif
+
+	//Tracking tables, split by address
+	Shard shards_[HEAPDEBUGGER_SHARDS];
+	//Whether operator new queues allocations instead of tracking them
+	std::atomic<bool> deferred_;
+	//Rings of all threads that queued allocations, newest first. Rings are
+	//never removed, the ring of an exited thread is taken over by a new
+	//thread, so the list can be walked without a lock.
+	std::atomic<AllocationRing*> rings_;
+	//Guards adding rings
+	SpinLock ringsLock_;
+	//Background thread of deferred tracking, and its stop flag
+	#if defined (_MSC_VER)
+	void* consumer_;
+	#else
+	pthread_t consumer_;
+	#endif
+	std::atomic<bool> stopConsumer_;
+	//Serializes turning deferred tracking on and off
+	std::mutex deferredLock_;
+
+	//Whether new allocations get pages of their own
+	std::atomic<bool> guardPages_;
+
+	//Every distinct allocation stack
+	StackDepot stacks_;
+
+	//Epoch new allocations are stamped with
+	std::atomic<uint32_t> epoch_;
+
+	//Reporter thread, its settings and its stop flag, guarded by reporterLock_
+	#if defined (_MSC_VER)
+	void* reporter_;
+	#else
+	pthread_t reporter_;
+	#endif
+	bool reporterRunning_;
+	bool stopReporter_;
+	unsigned int reportPeriodMs_;
+	uint32_t reportAge_;
+	std::mutex reporterLock_;
+	//Wakes the reporter thread when it has to stop
+	std::condition_variable reporterWake_;
+
+	//Mean number of bytes between sampled allocations, 0 when not sampling
+	std::atomic<size_t> sampleInterval_;
+	//Whether sampling was ever turned on, so untracked memory may exist
+	std::atomic<bool> sampled_;
+
+	//Allocations the tables could not grow to hold, their deletes are
+	//reported as NO_HEAP_POINTER
+	std::atomic<size_t> dropped_;
+
+	//Double and sized delete errors, kept for the report at exit because
+	//their freed records are dropped once the address is reused
+	FreedRecord* errors_;
+	size_t errorCount_;
+	SpinLock errorsLock_;
+
+	//Binary trace of all allocations, when started
+	TraceWriter trace_;
+	//Serializes starting and stopping the trace
+	std::mutex traceLock_;
+
+	//Serializes writing to the CSV file
+	std::recursive_mutex csvLock_;
+	//CSV file, buffered and written in the background
+	CsvLogger file_;
+	//CSV file of the outstanding allocation reports, opened on the first report
+	CsvLogger outstandingFile_;
+	//File and line of every return address written to the CSV, guarded by
+	//the CSV lock
+	SymbolCache symbols_;
 	//Whether csv file exists
 	bool createdFile_;
 };
 
+//the debugger singleton
+extern HeapDebugger& debugger;
+
 static struct HeapDebuggerInitializer {
 	HeapDebuggerInitializer();
 	~HeapDebuggerInitializer();
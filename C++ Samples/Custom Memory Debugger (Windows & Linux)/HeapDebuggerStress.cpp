@@ -0,0 +1,108 @@
+/*
+* ==============================================================
+* File   : HeapDebuggerStress.cpp
+* Purpose: Multi-threaded stress benchmark for the heap debugger,
+		   reports allocations per second for each thread count
+  Author : Rohit Saini
+* Date   : 11/2022
+* All code is Copyrighted to owner, Rohit Saini
+* ==============================================================
+*/
+
+//Build together with the debugger, for example on Linux:
+//  g++ -O2 -std=c++17 -pthread -fno-omit-frame-pointer " HeapDebugger.cpp" CsvLogger.cpp TraceWriter.cpp SlabAllocator.cpp SymbolCache.cpp StackDepot.cpp LargeAllocator.cpp HeapDebuggerStress.cpp -ldl -o HeapDebuggerStress
+//Frame pointers let the debugger record whole allocation stacks.
+//Usage:
+//  HeapDebuggerStress [allocations per thread] [max threads] [deferred | sampled]
+//Passing 'deferred' turns on deferred tracking for the whole run, 'sampled'
+//turns on deferred tracking together with sampling every SAMPLE_BYTES bytes.
+
+#include "HeapDebugger.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+//Allocations each thread keeps alive at once
+static const int BATCH = 64;
+
+//Mean bytes between sampled allocations of the 'sampled' run
+static const size_t SAMPLE_BYTES = 512 * 1024;
+
+//Allocate and free 'count' blocks of mixed sizes
+static void Worker(int count, unsigned seed, const std::atomic<bool>* start)
+{
+	char* blocks[BATCH];
+
+	//start all threads together
+	while (!start->load(std::memory_order_acquire))
+		std::this_thread::yield();
+
+	for (int done = 0; done < count; done += BATCH)
+	{
+		for (int i = 0; i < BATCH; i++)
+		{
+			seed = seed * 1103515245u + 12345u;
+			blocks[i] = new char[8 + (seed >> 16) % 504];
+			blocks[i][0] = static_cast<char>(i);
+		}
+
+		for (int i = 0; i < BATCH; i++)
+			delete[] blocks[i];
+	}
+}
+
+//Run 'threads' workers and return the allocations per second
+static double Run(int threads, int count)
+{
+	std::atomic<bool> start(false);
+	std::vector<std::thread> workers;
+
+	for (int t = 0; t < threads; t++)
+		workers.emplace_back(Worker, count, 12345u + t, &start);
+
+	std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+	start.store(true, std::memory_order_release);
+
+	for (std::thread& worker : workers)
+		worker.join();
+
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+	//rounds are whole batches
+	long long allocations = static_cast<long long>(threads) * ((count + BATCH - 1) / BATCH) * BATCH;
+	return seconds > 0.0 ? allocations / seconds : 0.0;
+}
+
+int main(int argc, char** argv)
+{
+	int count = argc > 1 ? atoi(argv[1]) : 200000;
+	int maxThreads = argc > 2 ? atoi(argv[2]) : static_cast<int>(std::thread::hardware_concurrency());
+
+	if (count <= 0)
+		count = 200000;
+	if (maxThreads <= 0)
+		maxThreads = 4;
+
+	bool sampled = argc > 3 && strcmp(argv[3], "sampled") == 0;
+	bool deferred = sampled || (argc > 3 && strcmp(argv[3], "deferred") == 0);
+	debugger.SetDeferredTracking(deferred);
+
+	if (sampled)
+		debugger.SetSampleInterval(SAMPLE_BYTES);
+
+	printf("%s%s tracking\n", sampled ? "sampled " : "", deferred ? "deferred" : "synchronous");
+	printf("threads, allocs/sec, allocs/sec per thread\n");
+
+	for (int threads = 1; threads <= maxThreads; threads *= 2)
+	{
+		double rate = Run(threads, count);
+		printf("%d, %.0f, %.0f\n", threads, rate, rate / threads);
+	}
+
+	return 0;
+}
@@ -0,0 +1,215 @@
+/*
+* ==============================================================
+* File   : LargeAllocator.cpp
+* Purpose: Maps large allocations of the heap debugger straight
+		   from the operating system, one mapping per block
+  Author : Rohit Saini
+* Date   : 11/2022
+* All code is Copyrighted to owner, Rohit Saini
+* ==============================================================
+*/
+
+#include "LargeAllocator.h"
+
+#include <cstdlib>      //malloc, the table must never call operator new
+#include <new>          //placement new of the table
+
+//include OS Specific functions only
+#if defined (_MSC_VER)
+#include <windows.h>
+
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+
+#endif
+
+//Size of a page of the system, asked for once
+static size_t PageSize()
+{
+	#if defined (_MSC_VER)
+		static const size_t size = [] { SYSTEM_INFO info; GetSystemInfo(&info); return static_cast<size_t>(info.dwPageSize); }();
+	#else
+		static const size_t size = sysconf(_SC_PAGESIZE) > 0 ? static_cast<size_t>(sysconf(_SC_PAGESIZE)) : 4096;
+	#endif
+
+	return size;
+}
+
+//'value' rounded up to a multiple of a power of two
+static uintptr_t RoundUp(uintptr_t value, size_t multiple)
+{
+	return (value + multiple - 1) & ~(uintptr_t(multiple) - 1);
+}
+
+//Map at least 'size' bytes
+void* LargeAllocator::Allocate(size_t size, size_t alignment)
+{
+	size_t pageSize = PageSize();
+	bool huge = hugePages_.load(std::memory_order_relaxed) && size >= HUGE_PAGE_BYTES;
+
+	if (alignment < pageSize)
+		alignment = pageSize;
+
+	size_t length = RoundUp(size, pageSize);
+	if (length < size)
+		return nullptr;
+
+	LargeBlock block;
+	void* memory = Map(length, alignment, huge, block);
+	if (memory == nullptr)
+		return nullptr;
+
+	block.address = memory;
+
+	{
+		SpinLockGuard guard(lock_);
+
+		//the table lives until the process exits
+		if (blocks_ == nullptr)
+		{
+			if (void* table = malloc(sizeof(AddressTable<LargeBlock>)))
+				blocks_ = new (table) AddressTable<LargeBlock>();
+		}
+
+		if (blocks_ != nullptr && blocks_->Insert(block) != nullptr)
+		{
+			count_.fetch_add(1, std::memory_order_relaxed);
+			return memory;
+		}
+	}
+
+	//no room to remember the block, so it could never be freed
+	Unmap(block);
+	return nullptr;
+}
+
+//Unmap a block
+bool LargeAllocator::Release(void* address)
+{
+	if (count_.load(std::memory_order_relaxed) == 0)
+		return false;
+
+	LargeBlock block;
+
+	{
+		SpinLockGuard guard(lock_);
+
+		LargeBlock* found = blocks_ != nullptr ? blocks_->Find(address) : nullptr;
+		if (found == nullptr)
+			return false;
+
+		block = *found;
+		blocks_->Erase(address);
+		count_.fetch_sub(1, std::memory_order_relaxed);
+	}
+
+	Unmap(block);
+	return true;
+}
+
+//Whether the address starts a block
+bool LargeAllocator::Contains(void* address)
+{
+	if (count_.load(std::memory_order_relaxed) == 0)
+		return false;
+
+	SpinLockGuard guard(lock_);
+	return blocks_ != nullptr && blocks_->Find(address) != nullptr;
+}
+
+//Map 'length' bytes whose start is aligned
+void* LargeAllocator::Map(size_t length, size_t alignment, bool huge, LargeBlock& block)
+{
+	#if defined (_MSC_VER)
+		//large pages need the lock pages privilege, without it they fail and
+		//normal pages are used
+		SIZE_T largePage = huge ? GetLargePageMinimum() : 0;
+		if (largePage != 0 && alignment <= largePage)
+		{
+			size_t hugeLength = RoundUp(length, largePage);
+			void* memory = VirtualAlloc(nullptr, hugeLength, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+			if (memory != nullptr)
+			{
+				block.base = memory;
+				block.length = hugeLength;
+				return memory;
+			}
+		}
+
+		//reserve room for an aligned start, and commit only the block
+		size_t reserved = length + alignment;
+		if (reserved < length)
+			return nullptr;
+
+		char* base = static_cast<char*>(VirtualAlloc(nullptr, reserved, MEM_RESERVE, PAGE_NOACCESS));
+		if (base == nullptr)
+			return nullptr;
+
+		char* start = reinterpret_cast<char*>(RoundUp(reinterpret_cast<uintptr_t>(base), alignment));
+		if (VirtualAlloc(start, length, MEM_COMMIT, PAGE_READWRITE) == nullptr)
+		{
+			VirtualFree(base, 0, MEM_RELEASE);
+			return nullptr;
+		}
+
+		block.base = base;
+		block.length = reserved;
+		return start;
+	#else
+		//explicit huge pages only work if the system has some reserved,
+		//otherwise transparent huge pages are asked for below
+		if (huge && alignment <= HUGE_PAGE_BYTES)
+		{
+			size_t hugeLength = RoundUp(length, HUGE_PAGE_BYTES);
+			void* memory = mmap(nullptr, hugeLength, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+			if (memory != MAP_FAILED)
+			{
+				block.base = memory;
+				block.length = hugeLength;
+				return memory;
+			}
+		}
+
+		//transparent huge pages need a huge page aligned range
+		if (huge && alignment < HUGE_PAGE_BYTES)
+			alignment = HUGE_PAGE_BYTES;
+
+		//mappings start on a page, anything more is made by mapping extra
+		//room and unmapping what is left over on both ends
+		size_t extra = alignment > PageSize() ? alignment : 0;
+		if (length + extra < length)
+			return nullptr;
+
+		void* mapping = mmap(nullptr, length + extra, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (mapping == MAP_FAILED)
+			return nullptr;
+
+		char* base = static_cast<char*>(mapping);
+		char* start = reinterpret_cast<char*>(RoundUp(reinterpret_cast<uintptr_t>(base), alignment));
+		size_t head = start - base;
+		size_t tail = extra - head;
+
+		if (head != 0)
+			munmap(base, head);
+		if (tail != 0)
+			munmap(start + length, tail);
+
+		if (huge)
+			madvise(start, length, MADV_HUGEPAGE);
+
+		block.base = start;
+		block.length = length;
+		return start;
+	#endif
+}
+
+//Free a mapping
+void LargeAllocator::Unmap(const LargeBlock& block)
+{
+	#if defined (_MSC_VER)
+		VirtualFree(block.base, 0, MEM_RELEASE);
+	#else
+		munmap(block.base, block.length);
+	#endif
+}
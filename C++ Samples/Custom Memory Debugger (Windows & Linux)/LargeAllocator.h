@@ -0,0 +1,77 @@
+/*
+* ==============================================================
+* File   : LargeAllocator.h
+* Purpose: Maps large allocations of the heap debugger straight
+		   from the operating system, one mapping per block
+  Author : Rohit Saini
+* Date   : 11/2022
+* All code is Copyrighted to owner, Rohit Saini
+* ==============================================================
+*/
+
+#ifndef LARGEALLOCATOR_H
+#define LARGEALLOCATOR_H
+
+#include "AddressTable.h"
+#include "SpinLock.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+//Every block is a mapping of its own, so freeing it gives the memory back
+//to the system right away. Blocks are found again through a small table of
+//their mappings. The constructor is constexpr and the table is never
+//destroyed, so blocks can be freed at any point of static destruction.
+class LargeAllocator
+{
+public:
+	constexpr LargeAllocator() : blocks_(nullptr), count_(0), lock_(), hugePages_(false) {}
+
+	//Size of a huge page
+	static const size_t HUGE_PAGE_BYTES = 2 * 1024 * 1024;
+
+	//Map at least 'size' bytes aligned to 'alignment', or to a page if it is
+	//smaller. Returns nullptr if the system has no memory for it.
+	void* Allocate(size_t size, size_t alignment);
+
+	//Unmap a block, false if the address does not start a block
+	bool Release(void* address);
+
+	//Whether the address starts a block
+	bool Contains(void* address);
+
+	//Back blocks of a huge page or more with huge pages, when the system has them
+	void SetHugePages(bool enabled) { hugePages_.store(enabled); }
+
+private:
+	//One mapping
+	struct LargeBlock
+	{
+		//Address handed out
+		void* address;
+		//Start and length of the mapping to free
+		void* base;
+		size_t length;
+	};
+
+	//Map 'length' bytes whose start is aligned, fills in the mapping to free
+	void* Map(size_t length, size_t alignment, bool huge, LargeBlock& block);
+	//Free a mapping
+	static void Unmap(const LargeBlock& block);
+
+	//Disable copying
+	LargeAllocator(const LargeAllocator&);
+	LargeAllocator& operator=(const LargeAllocator&);
+
+	//Mapping of every block, created with the first block
+	AddressTable<LargeBlock>* blocks_;
+	//Number of blocks, so frees skip the lock while there are none
+	std::atomic<size_t> count_;
+	//Guards the table
+	SpinLock lock_;
+	//Whether blocks use huge pages
+	std::atomic<bool> hugePages_;
+};
+
+#endif // LARGEALLOCATOR_H
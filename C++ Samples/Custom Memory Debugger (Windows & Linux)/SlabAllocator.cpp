@@ -0,0 +1,269 @@
+/*
+* ==============================================================
+* File   : SlabAllocator.cpp
+* Purpose: Size class slab allocator used as the fast memory
+		   backend of the heap debugger
+  Author : Rohit Saini
+* Date   : 11/2022
+* All code is Copyrighted to owner, Rohit Saini
+* ==============================================================
+*/
+
+#include "SlabAllocator.h"
+
+//include OS Specific functions only
+#if defined (_MSC_VER)
+#include <windows.h>
+
+#else
+#include <sys/mman.h>
+
+#endif
+
+//Object size of every class, multiples of 16 so every object is 16 byte aligned.
+//Steps grow with the size, so no class wastes more than about 20%.
+static const uint32_t CLASS_SIZES[SlabAllocator::CLASS_COUNT] =
+{
+	16, 32, 48, 64, 80, 96, 112, 128,
+	160, 192, 224, 256, 320, 384, 448, 512,
+	640, 768, 896, 1024, 1280, 1536, 1792, 2048,
+	2560, 3072, 3584, 4096, 5120, 6144, 7168, 8192
+};
+
+//Smallest class that fits 'size' bytes
+static int ClassOf(size_t size)
+{
+	int low = 0, high = SlabAllocator::CLASS_COUNT - 1;
+
+	while (low < high)
+	{
+		int middle = (low + high) / 2;
+
+		if (CLASS_SIZES[middle] < size)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+
+	return low;
+}
+
+//Largest power of two that divides an object size, the alignment of every
+//object of its class
+static size_t AlignmentOf(uint32_t size)
+{
+	return size & (~size + 1);
+}
+
+//Allocate at least 'size' bytes
+void* SlabAllocator::Allocate(size_t size)
+{
+	if (size > MAX_SIZE)
+		return nullptr;
+
+	return AllocateFromClass(ClassOf(size));
+}
+
+//Allocate at least 'size' bytes aligned to 'alignment'
+void* SlabAllocator::Allocate(size_t size, size_t alignment)
+{
+	if (size > MAX_SIZE || alignment > MAX_SIZE)
+		return nullptr;
+
+	//a larger class whose size is a multiple of the alignment
+	int sizeClass = ClassOf(size);
+	while (sizeClass < CLASS_COUNT && AlignmentOf(CLASS_SIZES[sizeClass]) < alignment)
+		sizeClass++;
+
+	return sizeClass < CLASS_COUNT ? AllocateFromClass(sizeClass) : nullptr;
+}
+
+//Allocate an object of a size class
+void* SlabAllocator::AllocateFromClass(int index)
+{
+	if (!Reserve())
+		return nullptr;
+
+	SizeClass& sizeClass = classes_[index];
+	SpinLockGuard guard(sizeClass.lock);
+
+	SlabHeader* slab = sizeClass.partial;
+
+	//every slab of the class is full
+	if (slab == nullptr)
+	{
+		slab = NewSlab(static_cast<int>(&sizeClass - classes_));
+		if (slab == nullptr)
+			return nullptr;
+
+		slab->next = nullptr;
+		slab->listed = true;
+		sizeClass.partial = slab;
+	}
+
+	//reuse a freed object, or take the next one that was never used
+	char* object;
+	if (slab->freeList != nullptr)
+	{
+		object = static_cast<char*>(slab->freeList);
+		slab->freeList = *reinterpret_cast<void**>(object);
+	}
+	else
+		object = slab->objects + static_cast<size_t>(slab->carved++) * slab->objectSize;
+
+	slab->State()[(object - slab->objects) / slab->objectSize] = 1;
+
+	//a full slab leaves the list until an object is freed
+	if (++slab->used == slab->capacity)
+	{
+		sizeClass.partial = slab->next;
+		slab->listed = false;
+	}
+
+	return object;
+}
+
+//Free an object
+SlabAllocator::Result SlabAllocator::Release(void* address)
+{
+	if (!Contains(address))
+		return NOT_SLAB;
+
+	SlabHeader* slab = SlabOf(address);
+	char* object = static_cast<char*>(address);
+
+	//the class of a slab never changes, so it can be read without the lock
+	SizeClass& sizeClass = classes_[slab->sizeClass];
+	SpinLockGuard guard(sizeClass.lock);
+
+	//a slab is published with its header written, a size of zero means the
+	//address is not in a slab at all
+	if (slab->objectSize == 0)
+		return NOT_AN_OBJECT;
+
+	size_t offset = object - slab->objects;
+	size_t index = offset / slab->objectSize;
+
+	if (object < slab->objects || offset % slab->objectSize != 0 || index >= slab->carved)
+		return NOT_AN_OBJECT;
+
+	if (slab->State()[index] == 0)
+		return ALREADY_FREE;
+
+	slab->State()[index] = 0;
+	*reinterpret_cast<void**>(object) = slab->freeList;
+	slab->freeList = object;
+	slab->used--;
+
+	//the slab has room again
+	if (!slab->listed)
+	{
+		slab->next = sizeClass.partial;
+		slab->listed = true;
+		sizeClass.partial = slab;
+	}
+
+	return RELEASED;
+}
+
+//Usable size of an object from the arena
+size_t SlabAllocator::SizeOf(void* address) const
+{
+	return Contains(address) ? SlabOf(address)->objectSize : 0;
+}
+
+//Reserve the arena on first use
+bool SlabAllocator::Reserve()
+{
+	if (arenaBegin_.load(std::memory_order_acquire) != 0)
+		return true;
+
+	if (failed_.load(std::memory_order_relaxed))
+		return false;
+
+	SpinLockGuard guard(arenaLock_);
+
+	//another thread reserved it while this one waited
+	if (arenaBegin_.load(std::memory_order_relaxed) != 0)
+		return true;
+
+	//one extra slab, so the start can be aligned to the slab size
+	size_t bytes = HEAPDEBUGGER_ARENA_BYTES + SLAB_BYTES;
+
+	#if defined (_MSC_VER)
+		//address space only, slabs are committed as they are carved
+		void* memory = VirtualAlloc(nullptr, bytes, MEM_RESERVE, PAGE_NOACCESS);
+	#else
+		//pages are only backed by memory once they are touched
+		void* memory = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+		if (memory == MAP_FAILED)
+			memory = nullptr;
+	#endif
+
+	if (memory == nullptr)
+	{
+		failed_.store(true);
+		return false;
+	}
+
+	uintptr_t begin = (reinterpret_cast<uintptr_t>(memory) + SLAB_BYTES - 1) & ~(uintptr_t(SLAB_BYTES) - 1);
+
+	arenaEnd_ = begin + HEAPDEBUGGER_ARENA_BYTES;
+	arenaNext_.store(begin);
+	arenaBegin_.store(begin, std::memory_order_release);
+
+	return true;
+}
+
+//Carve a new slab for a size class
+SlabAllocator::SlabHeader* SlabAllocator::NewSlab(int sizeClass)
+{
+	//carved under the lock, so Contains only sees slabs whose header is written
+	SpinLockGuard guard(arenaLock_);
+
+	uintptr_t address = arenaNext_.load(std::memory_order_relaxed);
+
+	//the arena is used up, allocations fall back to pages
+	if (address + SLAB_BYTES > arenaEnd_)
+		return nullptr;
+
+	#if defined (_MSC_VER)
+		if (VirtualAlloc(reinterpret_cast<void*>(address), SLAB_BYTES, MEM_COMMIT, PAGE_READWRITE) == nullptr)
+			return nullptr;
+	#endif
+
+	SlabHeader* slab = reinterpret_cast<SlabHeader*>(address);
+	uint32_t size = CLASS_SIZES[sizeClass];
+
+	//the first object starts at a multiple of the class's alignment, so every
+	//object is aligned to it and aligned allocations can use the class
+	size_t alignment = AlignmentOf(size);
+
+	//as many objects as fit after the header and its state bytes
+	uint32_t capacity = static_cast<uint32_t>((SLAB_BYTES - sizeof(SlabHeader)) / (size + 1));
+	size_t headerBytes;
+
+	for (;;)
+	{
+		headerBytes = (sizeof(SlabHeader) + capacity + alignment - 1) & ~(alignment - 1);
+		if (headerBytes + static_cast<size_t>(capacity) * size <= SLAB_BYTES)
+			break;
+		capacity--;
+	}
+
+	slab->next = nullptr;
+	slab->freeList = nullptr;
+	slab->objects = reinterpret_cast<char*>(address) + headerBytes;
+	slab->objectSize = size;
+	slab->capacity = capacity;
+	slab->used = 0;
+	slab->carved = 0;
+	slab->sizeClass = sizeClass;
+	slab->listed = false;
+
+	//publish the slab, frees of its objects can find it from here on
+	arenaNext_.store(address + SLAB_BYTES, std::memory_order_release);
+
+	//fresh pages are zero, so every state byte already says free
+	return slab;
+}
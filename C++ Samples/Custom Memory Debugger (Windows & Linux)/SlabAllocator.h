@@ -0,0 +1,136 @@
+/*
+* ==============================================================
+* File   : SlabAllocator.h
+* Purpose: Size class slab allocator used as the fast memory
+		   backend of the heap debugger
+  Author : Rohit Saini
+* Date   : 11/2022
+* All code is Copyrighted to owner, Rohit Saini
+* ==============================================================
+*/
+
+#ifndef SLABALLOCATOR_H
+#define SLABALLOCATOR_H
+
+#include "SpinLock.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+//Size of the address range reserved for slabs, memory is only used once
+//slabs are handed out
+#ifndef HEAPDEBUGGER_ARENA_BYTES
+#define HEAPDEBUGGER_ARENA_BYTES (sizeof(void*) == 8 ? (size_t(64) << 30) : (size_t(256) << 20))
+#endif
+
+//Small allocations are rounded up to one of a few size classes and carved
+//from 64 KB slabs in one reserved arena. A slab only holds objects of one
+//class, and its header holds one state byte per object, so freeing finds
+//everything it needs by masking the address. The constructor is constexpr,
+//so a static allocator is ready before any other static is constructed and
+//stays usable while statics are destroyed.
+class SlabAllocator
+{
+public:
+	constexpr SlabAllocator() : arenaBegin_(0), arenaNext_(0), arenaEnd_(0), arenaLock_(), failed_(false), classes_() {}
+
+	//Bytes in a slab, slabs are aligned to their size
+	static const size_t SLAB_BYTES = 64 * 1024;
+	//Largest allocation served from slabs
+	static const size_t MAX_SIZE = 8192;
+	//Number of size classes
+	static const int CLASS_COUNT = 32;
+
+	//Outcome of Release
+	enum Result
+	{
+		RELEASED,       //the object was freed
+		NOT_SLAB,       //the address is not in the arena
+		ALREADY_FREE,   //the object was not allocated, a double free
+		NOT_AN_OBJECT   //the address is inside the arena but not the start of an object
+	};
+
+	//Allocate at least 'size' bytes, 16 byte aligned. Returns nullptr if the
+	//size is too large or the arena is used up.
+	void* Allocate(size_t size);
+	//Allocate at least 'size' bytes aligned to 'alignment', a power of two up
+	//to MAX_SIZE. Served from the smallest class whose objects are aligned.
+	void* Allocate(size_t size, size_t alignment);
+
+	//Free an object
+	Result Release(void* address);
+
+	//Whether an address is inside the arena
+	bool Contains(void* address) const
+	{
+		uintptr_t value = reinterpret_cast<uintptr_t>(address);
+		uintptr_t begin = arenaBegin_.load(std::memory_order_acquire);
+		return begin != 0 && value >= begin && value < arenaNext_.load(std::memory_order_acquire);
+	}
+
+	//Usable size of an object from the arena
+	size_t SizeOf(void* address) const;
+
+private:
+	//Start of every slab
+	struct SlabHeader
+	{
+		//Next slab of the class with free objects
+		SlabHeader* next;
+		//Freed objects, linked through their first bytes
+		void* freeList;
+		//First object
+		char* objects;
+		uint32_t objectSize;
+		uint32_t capacity;
+		//Objects handed out now
+		uint32_t used;
+		//Objects handed out at least once, the rest have never been touched
+		uint32_t carved;
+		int sizeClass;
+		//Whether the slab is on its class's list
+		bool listed;
+
+		//One byte per object, 0 when free, follows the header
+		uint8_t* State() { return reinterpret_cast<uint8_t*>(this + 1); }
+	};
+
+	//Slabs of one size class
+	struct alignas(64) SizeClass
+	{
+		SpinLock lock;
+		//Slabs with at least one free object
+		SlabHeader* partial = nullptr;
+	};
+
+	//Allocate an object of a size class
+	void* AllocateFromClass(int index);
+	//Reserve the arena on first use
+	bool Reserve();
+	//Carve a new slab for a size class, the class lock must be held
+	SlabHeader* NewSlab(int sizeClass);
+	//Slab that contains an address of the arena
+	static SlabHeader* SlabOf(void* address)
+	{
+		return reinterpret_cast<SlabHeader*>(reinterpret_cast<uintptr_t>(address) & ~(uintptr_t(SLAB_BYTES) - 1));
+	}
+
+	//Disable copying
+	SlabAllocator(const SlabAllocator&);
+	SlabAllocator& operator=(const SlabAllocator&);
+
+	//Arena range, [begin, next) has been handed out as slabs. next only
+	//moves past a slab once its header is written.
+	std::atomic<uintptr_t> arenaBegin_;
+	std::atomic<uintptr_t> arenaNext_;
+	uintptr_t arenaEnd_;
+	//Guards reserving the arena and carving slabs
+	SpinLock arenaLock_;
+	//Set if reserving failed, so it is not retried on every allocation
+	std::atomic<bool> failed_;
+
+	SizeClass classes_[CLASS_COUNT];
+};
+
+#endif // SLABALLOCATOR_H
@@ -0,0 +1,69 @@
+/*
+* ==============================================================
+* File   : SpinLock.h
+* Purpose: Small spin lock for the heap debugger, it never allocates
+		   so it can be taken inside operator new and delete
+  Author : Rohit Saini
+* Date   : 11/2022
+* All code is Copyrighted to owner, Rohit Saini
+* ==============================================================
+*/
+
+#ifndef SPINLOCK_H
+#define SPINLOCK_H
+
+#include <atomic>   //atomic_bool
+#include <thread>   //this_thread::yield
+
+//Test and test-and-set lock, critical sections in the debugger are a few
+//table operations long so spinning is cheaper than sleeping
+class SpinLock
+{
+public:
+	constexpr SpinLock() : locked_(false) {}
+
+	void Lock()
+	{
+		for (int spins = 0; ; spins++)
+		{
+			//only try to take the lock when it looks free, so waiting
+			//threads spin on their cached copy of the line
+			if (!locked_.load(std::memory_order_relaxed) &&
+				!locked_.exchange(true, std::memory_order_acquire))
+				return;
+
+			//give the holder a chance to run if it was preempted
+			if (spins >= 64)
+				std::this_thread::yield();
+		}
+	}
+
+	void Unlock()
+	{
+		locked_.store(false, std::memory_order_release);
+	}
+
+private:
+	//Disable copying
+	SpinLock(const SpinLock&);
+	SpinLock& operator=(const SpinLock&);
+
+	std::atomic<bool> locked_;
+};
+
+//Holds a spin lock for the life of a scope
+class SpinLockGuard
+{
+public:
+	explicit SpinLockGuard(SpinLock& lock) : lock_(lock) { lock_.Lock(); }
+	~SpinLockGuard() { lock_.Unlock(); }
+
+private:
+	//Disable copying
+	SpinLockGuard(const SpinLockGuard&);
+	SpinLockGuard& operator=(const SpinLockGuard&);
+
+	SpinLock& lock_;
+};
+
+#endif // SPINLOCK_H
@@ -0,0 +1,244 @@
+/*
+* ==============================================================
+* File   : StackDepot.cpp
+* Purpose: Captures call stacks and stores every distinct stack
+		   once, allocations refer to them by a 32 bit id
+  Author : Rohit Saini
+* Date   : 11/2022
+* All code is Copyrighted to owner, Rohit Saini
+* ==============================================================
+*/
+
+#include "StackDepot.h"
+
+#include <cstdlib>      //malloc, the depot must never call operator new
+#include <cstring>
+#include <new>          //placement new of the records
+
+//include OS Specific functions only
+#if defined (_MSC_VER)
+#include <windows.h>
+
+#else
+#include <pthread.h>
+
+#endif
+
+StackDepot::StackDepot() : chunk_(nullptr), chunkUsed_(CHUNK_BYTES)
+{
+	buckets_ = static_cast<std::atomic<StackRecord*>*>(calloc(HEAPDEBUGGER_STACK_BUCKETS, sizeof(std::atomic<StackRecord*>)));
+
+	for (std::atomic<StackRecord**>& page : directory_)
+		page.store(nullptr, std::memory_order_relaxed);
+
+	count_.store(0);
+}
+
+StackDepot::~StackDepot()
+{
+	for (std::atomic<StackRecord**>& page : directory_)
+		free(page.load());
+
+	//every chunk starts with the address of the one before it
+	while (chunk_ != nullptr)
+	{
+		char* previous = *reinterpret_cast<char**>(chunk_);
+		free(chunk_);
+		chunk_ = previous;
+	}
+
+	free(buckets_);
+}
+
+//Return addresses of the calling thread's stack
+int StackDepot::Capture(void** frames, int maxFrames)
+{
+	#if defined (_MSC_VER)
+		return RtlCaptureStackBackTrace(0, static_cast<DWORD>(maxFrames), frames, nullptr);
+	#else
+		//range of the thread's stack, a frame pointer outside it ends the walk
+		static thread_local uintptr_t stackLow = 0, stackHigh = 0;
+		static thread_local bool stackKnown = false;
+
+		if (!stackKnown)
+		{
+			pthread_attr_t attributes;
+			if (pthread_getattr_np(pthread_self(), &attributes) == 0)
+			{
+				void* low;
+				size_t size;
+				if (pthread_attr_getstack(&attributes, &low, &size) == 0)
+				{
+					stackLow = reinterpret_cast<uintptr_t>(low);
+					stackHigh = stackLow + size;
+				}
+				pthread_attr_destroy(&attributes);
+			}
+			stackKnown = true;
+		}
+
+		//each frame holds the caller's frame pointer and then the return address
+		void** frame = static_cast<void**>(__builtin_frame_address(0));
+		int count = 0;
+
+		while (count < maxFrames)
+		{
+			uintptr_t address = reinterpret_cast<uintptr_t>(frame);
+			if (address < stackLow || address + 2 * sizeof(void*) > stackHigh || address % sizeof(void*) != 0)
+				break;
+
+			void* returnAddress = frame[1];
+			if (returnAddress == nullptr)
+				break;
+
+			frames[count++] = returnAddress;
+
+			//the stack grows down, so every caller's frame is higher
+			void** next = static_cast<void**>(frame[0]);
+			if (next <= frame)
+				break;
+			frame = next;
+		}
+
+		return count;
+	#endif
+}
+
+//Id of a stack, the same frames always get the same id
+uint32_t StackDepot::Intern(void* const* frames, int count)
+{
+	if (count <= 0 || buckets_ == nullptr)
+		return NO_STACK;
+
+	uint32_t hash = Hash(frames, count);
+
+	//most stacks were seen before, found without the lock
+	if (StackRecord* record = Find(hash, frames, count))
+		return record->id;
+
+	SpinLockGuard guard(lock_);
+
+	//another thread may have added it meanwhile
+	if (StackRecord* record = Find(hash, frames, count))
+		return record->id;
+
+	uint32_t id = count_.load(std::memory_order_relaxed) + 1;
+	if (id >= PAGE_IDS * DIRECTORY_PAGES)
+		return NO_STACK;
+
+	std::atomic<StackRecord**>& page = directory_[id / PAGE_IDS];
+	if (page.load(std::memory_order_relaxed) == nullptr)
+	{
+		StackRecord** ids = static_cast<StackRecord**>(calloc(PAGE_IDS, sizeof(StackRecord*)));
+		if (ids == nullptr)
+			return NO_STACK;
+		page.store(ids, std::memory_order_release);
+	}
+
+	void* memory = Carve(sizeof(StackRecord) + count * sizeof(void*));
+	if (memory == nullptr)
+		return NO_STACK;
+
+	StackRecord* record = new (memory) StackRecord;
+	record->allocations.store(0, std::memory_order_relaxed);
+	record->allocatedBytes.store(0, std::memory_order_relaxed);
+	record->hash = hash;
+	record->id = id;
+	record->count = static_cast<uint32_t>(count);
+	memcpy(record->Frames(), frames, count * sizeof(void*));
+
+	//publish the finished record, readers only ever see complete stacks
+	std::atomic<StackRecord*>& bucket = buckets_[hash % HEAPDEBUGGER_STACK_BUCKETS];
+	record->next = bucket.load(std::memory_order_relaxed);
+	page.load(std::memory_order_relaxed)[id % PAGE_IDS] = record;
+	count_.store(id, std::memory_order_release);
+	bucket.store(record, std::memory_order_release);
+
+	return id;
+}
+
+//Frames of a stack id
+int StackDepot::Frames(uint32_t id, void* const*& frames) const
+{
+	StackRecord* record = Record(id);
+	if (record == nullptr)
+		return 0;
+
+	frames = record->Frames();
+	return static_cast<int>(record->count);
+}
+
+//Count an allocation of 'bytes' bytes made from a stack
+void StackDepot::CountAllocation(uint32_t id, size_t bytes)
+{
+	if (StackRecord* record = Record(id))
+	{
+		record->allocations.fetch_add(1, std::memory_order_relaxed);
+		record->allocatedBytes.fetch_add(bytes, std::memory_order_relaxed);
+	}
+}
+
+//Allocations made from a stack so far
+void StackDepot::Allocations(uint32_t id, uint64_t& count, uint64_t& bytes) const
+{
+	StackRecord* record = Record(id);
+
+	count = record != nullptr ? record->allocations.load(std::memory_order_relaxed) : 0;
+	bytes = record != nullptr ? record->allocatedBytes.load(std::memory_order_relaxed) : 0;
+}
+
+//Stack of an id
+StackDepot::StackRecord* StackDepot::Record(uint32_t id) const
+{
+	if (id == NO_STACK || id > count_.load(std::memory_order_acquire))
+		return nullptr;
+
+	return directory_[id / PAGE_IDS].load(std::memory_order_acquire)[id % PAGE_IDS];
+}
+
+//Hash of a list of frames
+uint32_t StackDepot::Hash(void* const* frames, int count)
+{
+	uint64_t hash = static_cast<uint64_t>(count);
+
+	for (int i = 0; i < count; i++)
+	{
+		hash ^= static_cast<uint64_t>(reinterpret_cast<uintptr_t>(frames[i]));
+		hash *= 0xff51afd7ed558ccdULL;
+		hash ^= hash >> 33;
+	}
+
+	return static_cast<uint32_t>(hash);
+}
+
+//Stored stack equal to the frames
+StackDepot::StackRecord* StackDepot::Find(uint32_t hash, void* const* frames, int count) const
+{
+	StackRecord* record = buckets_[hash % HEAPDEBUGGER_STACK_BUCKETS].load(std::memory_order_acquire);
+
+	for (; record != nullptr; record = record->next)
+		if (record->hash == hash && record->count == static_cast<uint32_t>(count) &&
+			memcmp(record->Frames(), frames, count * sizeof(void*)) == 0)
+			return record;
+
+	return nullptr;
+}
+
+//Memory for a new stack
+void* StackDepot::Carve(size_t bytes)
+{
+	if (chunkUsed_ + bytes > CHUNK_BYTES)
+	{
+		char* chunk = static_cast<char*>(malloc(CHUNK_BYTES));
+		if (chunk == nullptr)
+			return nullptr;
+
+		*reinterpret_cast<char**>(chunk) = chunk_;
+		chunk_ = chunk;
+		chunkUsed_ = sizeof(void*);
+	}
+
+	void* memory = chunk_ + chunkUsed_;
+	chunkUsed_ += bytes;
+	return memory;
+}
@@ -0,0 +1,110 @@
+/*
+* ==============================================================
+* File   : StackDepot.h
+* Purpose: Captures call stacks and stores every distinct stack
+		   once, allocations refer to them by a 32 bit id
+  Author : Rohit Saini
+* Date   : 11/2022
+* All code is Copyrighted to owner, Rohit Saini
+* ==============================================================
+*/
+
+#ifndef STACKDEPOT_H
+#define STACKDEPOT_H
+
+#include "SpinLock.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+//Number of hash buckets of the depot
+#ifndef HEAPDEBUGGER_STACK_BUCKETS
+#define HEAPDEBUGGER_STACK_BUCKETS 65536
+#endif
+
+//Programs allocate from a small number of distinct call paths, so each
+//stack is stored once and looked up by its hash. Stacks are never removed,
+//their memory comes from large malloc'ed chunks and their ids index a two
+//level directory. Finding a stored stack takes no lock, only adding a new
+//one does.
+class StackDepot
+{
+public:
+	StackDepot();
+	~StackDepot();
+
+	//Id 0 stands for no stack
+	static const uint32_t NO_STACK = 0;
+
+	//Return addresses of the calling thread's stack, innermost first. Walks
+	//the frame pointer chain, so code built without frame pointers ends the
+	//stack early.
+	static int Capture(void** frames, int maxFrames);
+
+	//Id of a stack, the same frames always get the same id. NO_STACK if the
+	//stack is empty or the depot is out of memory.
+	uint32_t Intern(void* const* frames, int count);
+
+	//Frames of a stack id, returns the number of frames, 0 if the id is unknown
+	int Frames(uint32_t id, void* const*& frames) const;
+
+	//Count an allocation of 'bytes' bytes made from a stack
+	void CountAllocation(uint32_t id, size_t bytes);
+	//Allocations made from a stack so far, counted with CountAllocation
+	void Allocations(uint32_t id, uint64_t& count, uint64_t& bytes) const;
+
+	//Number of distinct stacks
+	size_t Size() const { return count_.load(std::memory_order_relaxed); }
+
+private:
+	//One stored stack, its frames follow it
+	struct StackRecord
+	{
+		//Next stack of the same bucket
+		StackRecord* next;
+		uint32_t hash;
+		uint32_t id;
+		uint32_t count;
+		//Allocations made from the stack, and their bytes
+		std::atomic<uint64_t> allocations;
+		std::atomic<uint64_t> allocatedBytes;
+
+		void** Frames() { return reinterpret_cast<void**>(this + 1); }
+	};
+
+	//Ids per directory page, and the number of pages
+	static const uint32_t PAGE_IDS = 4096;
+	static const uint32_t DIRECTORY_PAGES = 4096;
+	//Bytes of each chunk the stacks are carved from
+	static const size_t CHUNK_BYTES = 1 << 20;
+
+	//Stack of an id, nullptr if the id is unknown
+	StackRecord* Record(uint32_t id) const;
+	//Hash of a list of frames
+	static uint32_t Hash(void* const* frames, int count);
+	//Stored stack equal to the frames, nullptr if there is none
+	StackRecord* Find(uint32_t hash, void* const* frames, int count) const;
+	//Memory for a new stack, the lock must be held
+	void* Carve(size_t bytes);
+
+	//Disable copying
+	StackDepot(const StackDepot&);
+	StackDepot& operator=(const StackDepot&);
+
+	//Newest stack of every bucket
+	std::atomic<StackRecord*>* buckets_;
+	//Pages of stacks by id
+	std::atomic<StackRecord**> directory_[DIRECTORY_PAGES];
+	//Number of stacks, the last id handed out
+	std::atomic<uint32_t> count_;
+
+	//Chunk stacks are carved from, linked through their first bytes
+	char* chunk_;
+	size_t chunkUsed_;
+
+	//Serializes adding stacks
+	SpinLock lock_;
+};
+
+#endif // STACKDEPOT_H
@@ -0,0 +1,328 @@
+/*
+* ==============================================================
+* File   : SymbolCache.cpp
+* Purpose: Cache of the file and line of return addresses, so
+		   reports resolve every address only once
+  Author : Rohit Saini
+* Date   : 11/2022
+* All code is Copyrighted to owner, Rohit Saini
+* ==============================================================
+*/
+
+#include "SymbolCache.h"
+
+//This file is not included, since this is a sample
+#include "Common.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+//include OS Specific functions only
+#if defined (_MSC_VER)
+#include "WinFunctions.h"   //This file is NOT included, as this is a display sample
+
+#else
+#include "LinuxFunctions.h" //This file is NOT included, as this is a display sample
+#include <dlfcn.h>          //dladdr
+#include <fcntl.h>          //O_RDONLY
+#include <link.h>           //ElfW
+#include <spawn.h>          //posix_spawnp
+#include <sys/auxv.h>       //getauxval
+#include <sys/wait.h>       //waitpid
+#include <unistd.h>
+
+extern char** environ;
+
+#endif
+
+//Copy of a string in malloc memory
+static char* CopyString(const char* text)
+{
+	if (text == nullptr)
+		text = "";
+
+	size_t length = strlen(text) + 1;
+	char* copy = static_cast<char*>(malloc(length));
+	if (copy != nullptr)
+		memcpy(copy, text, length);
+
+	return copy;
+}
+
+SymbolCache::SymbolCache()
+{
+	memset(unknown_, 0, sizeof(unknown_));
+}
+
+SymbolCache::~SymbolCache()
+{
+	Clear();
+}
+
+//Remember an address for the next Resolve
+void SymbolCache::Add(void* address, bool deleteError)
+{
+	AddressTable<Symbol>& table = tables_[deleteError];
+
+	if (address != nullptr && table.Find(address) == nullptr)
+	{
+		Symbol symbol = { address, nullptr, 0 };
+		table.Insert(symbol);
+	}
+}
+
+//Resolve every added address that is not known yet
+void SymbolCache::Resolve()
+{
+	#if !defined (_MSC_VER)
+		//one external run per module instead of one lookup per address
+		if (const char* program = getenv("HEAPDEBUGGER_ADDR2LINE"))
+			ResolveWithAddr2Line(program);
+	#endif
+
+	//whatever is left goes through the platform functions
+	for (int deleteError = 0; deleteError < 2; deleteError++)
+		tables_[deleteError].ForEach([deleteError](Symbol& symbol)
+		{
+			if (symbol.file == nullptr)
+				ResolveOne(symbol, deleteError != 0);
+		});
+}
+
+//Location of an address, resolved now if it is not known yet
+const Symbol& SymbolCache::Lookup(void* address, bool deleteError)
+{
+	AddressTable<Symbol>& table = tables_[deleteError];
+	Symbol* symbol = address != nullptr ? table.Find(address) : nullptr;
+
+	if (symbol == nullptr && address != nullptr)
+	{
+		Symbol added = { address, nullptr, 0 };
+		symbol = table.Insert(added);
+	}
+
+	//a null address, or an address the table had no room for, is not cached
+	if (symbol == nullptr)
+	{
+		symbol = &unknown_[deleteError];
+		free(symbol->file);
+		symbol->address = address;
+		symbol->file = nullptr;
+	}
+
+	if (symbol->file == nullptr)
+		ResolveOne(*symbol, deleteError);
+
+	return *symbol;
+}
+
+//Forget every symbol
+void SymbolCache::Clear()
+{
+	for (int deleteError = 0; deleteError < 2; deleteError++)
+	{
+		tables_[deleteError].ForEach([](Symbol& symbol) { free(symbol.file); });
+		tables_[deleteError].Clear();
+
+		free(unknown_[deleteError].file);
+		unknown_[deleteError].file = nullptr;
+		unknown_[deleteError].address = nullptr;
+	}
+}
+
+//Resolve one address with the platform symbol functions
+void SymbolCache::ResolveOne(Symbol& symbol, bool deleteError)
+{
+	int LineNo = 0;
+
+	//Windows SPECIFIC GET FUNCTION
+	#if defined (_MSC_VER)
+		const char* fileName = nullptr;
+		Funcs::GetSymFromAddress(symbol.address, &LineNo, fileName, deleteError);
+		symbol.file = CopyString(fileName);
+	#else
+		Basic_String str = Funcs::GetSymFromAddress(symbol.address, &LineNo, deleteError);
+		symbol.file = CopyString(str.c_str());
+	#endif
+
+	symbol.line = LineNo;
+}
+
+#if !defined (_MSC_VER)
+//Pending address and the module it belongs to
+struct ModuleAddress
+{
+	void* address;
+	void* base;
+	const char* path;
+};
+
+//Order by module, then by address
+static int CompareModuleAddress(const void* left, const void* right)
+{
+	const ModuleAddress* a = static_cast<const ModuleAddress*>(left);
+	const ModuleAddress* b = static_cast<const ModuleAddress*>(right);
+
+	if (a->base != b->base)
+		return a->base < b->base ? -1 : 1;
+	if (a->address != b->address)
+		return a->address < b->address ? -1 : 1;
+	return 0;
+}
+
+//Start addr2line on a module with the list file as its input. No shell is
+//involved, so paths are passed as they are and need no quoting. Returns the
+//output of addr2line, or nullptr if it could not be started.
+static FILE* StartAddr2Line(const char* program, const char* module, const char* listPath, pid_t& child)
+{
+	int pipes[2];
+	if (pipe(pipes) != 0)
+		return nullptr;
+
+	posix_spawn_file_actions_t actions;
+	posix_spawn_file_actions_init(&actions);
+	posix_spawn_file_actions_addopen(&actions, 0, listPath, O_RDONLY, 0);
+	posix_spawn_file_actions_adddup2(&actions, pipes[1], 1);
+	posix_spawn_file_actions_addclose(&actions, pipes[0]);
+	posix_spawn_file_actions_addclose(&actions, pipes[1]);
+
+	char* argv[] = { const_cast<char*>(program), const_cast<char*>("-e"), const_cast<char*>(module), nullptr };
+	int failed = posix_spawnp(&child, program, &actions, nullptr, argv, environ);
+
+	posix_spawn_file_actions_destroy(&actions);
+	close(pipes[1]);
+
+	FILE* output = failed == 0 ? fdopen(pipes[0], "r") : nullptr;
+	if (output == nullptr)
+	{
+		close(pipes[0]);
+		if (failed == 0)
+			waitpid(child, nullptr, 0);
+	}
+
+	return output;
+}
+
+//Resolve the pending addresses of both tables with addr2line, one run per module
+void SymbolCache::ResolveWithAddr2Line(const char* program)
+{
+	size_t pending = 0;
+	for (AddressTable<Symbol>& table : tables_)
+		table.ForEach([&pending](Symbol& symbol) { pending += symbol.file == nullptr; });
+
+	if (pending == 0)
+		return;
+
+	ModuleAddress* addresses = static_cast<ModuleAddress*>(malloc(pending * sizeof(ModuleAddress)));
+	if (addresses == nullptr)
+		return;
+
+	//the main program is named by the kernel, its own name may be relative
+	char mainPath[4096];
+	ssize_t mainLength = readlink("/proc/self/exe", mainPath, sizeof(mainPath) - 1);
+	mainPath[mainLength > 0 ? mainLength : 0] = '\0';
+
+	Dl_info info;
+	void* mainBase = dladdr(reinterpret_cast<void*>(getauxval(AT_PHDR)), &info) ? info.dli_fbase : nullptr;
+
+	size_t count = 0;
+	for (AddressTable<Symbol>& table : tables_)
+		table.ForEach([&](Symbol& symbol)
+		{
+			if (symbol.file != nullptr || !dladdr(symbol.address, &info) || info.dli_fname == nullptr)
+				return;
+
+			ModuleAddress address = { symbol.address, info.dli_fbase,
+				info.dli_fbase == mainBase && mainPath[0] != '\0' ? mainPath : info.dli_fname };
+			addresses[count++] = address;
+		});
+
+	qsort(addresses, count, sizeof(ModuleAddress), CompareModuleAddress);
+
+	for (size_t first = 0, last; first < count; first = last)
+	{
+		//position independent modules are read with offsets from their base
+		void* base = addresses[first].base;
+		uintptr_t offset = reinterpret_cast<const ElfW(Ehdr)*>(base)->e_type == ET_DYN ? reinterpret_cast<uintptr_t>(base) : 0;
+
+		//every address of the module in one list, an address pending in both
+		//tables is listed once
+		char listPath[] = "/tmp/heapdebugger_symbolsXXXXXX";
+		int listFile = mkstemp(listPath);
+		FILE* list = listFile >= 0 ? fdopen(listFile, "w") : nullptr;
+
+		if (list == nullptr)
+		{
+			if (listFile >= 0)
+			{
+				close(listFile);
+				unlink(listPath);
+			}
+			break;
+		}
+
+		for (last = first; last < count && addresses[last].base == base; last++)
+		{
+			if (last != first && addresses[last].address == addresses[last - 1].address)
+				continue;
+
+			//one byte back, a return address already belongs to the next line
+			fprintf(list, "%zx\n", static_cast<size_t>(reinterpret_cast<uintptr_t>(addresses[last].address) - 1 - offset));
+		}
+
+		fclose(list);
+
+		//addr2line answers each address with one "file:line" line, in order
+		pid_t child;
+		FILE* output = StartAddr2Line(program, addresses[first].path, listPath, child);
+		char line[4096];
+
+		for (size_t i = first; output != nullptr && i < last; i++)
+		{
+			if (i != first && addresses[i].address == addresses[i - 1].address)
+				continue;
+
+			if (fgets(line, sizeof(line), output) == nullptr)
+				break;
+
+			//drop the newline and a trailing " (discriminator N)"
+			line[strcspn(line, "\r\n")] = '\0';
+			if (char* extra = strstr(line, " ("))
+				*extra = '\0';
+
+			char* colon = strrchr(line, ':');
+			if (colon == nullptr)
+				continue;
+			*colon = '\0';
+
+			//no debug information, left for the platform functions
+			if (strcmp(line, "??") == 0)
+				continue;
+
+			for (AddressTable<Symbol>& table : tables_)
+			{
+				Symbol* symbol = table.Find(addresses[i].address);
+				if (symbol != nullptr && symbol->file == nullptr)
+				{
+					symbol->file = CopyString(line);
+					symbol->line = atoi(colon + 1);
+				}
+			}
+		}
+
+		if (output != nullptr)
+		{
+			fclose(output);
+			waitpid(child, nullptr, 0);
+		}
+		unlink(listPath);
+
+		//addr2line could not be started, do not try the other modules
+		if (output == nullptr)
+			break;
+	}
+
+	free(addresses);
+}
+#endif
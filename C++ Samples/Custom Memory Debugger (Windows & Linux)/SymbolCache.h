@@ -0,0 +1,67 @@
+/*
+* ==============================================================
+* File   : SymbolCache.h
+* Purpose: Cache of the file and line of return addresses, so
+		   reports resolve every address only once
+  Author : Rohit Saini
+* Date   : 11/2022
+* All code is Copyrighted to owner, Rohit Saini
+* ==============================================================
+*/
+
+#ifndef SYMBOLCACHE_H
+#define SYMBOLCACHE_H
+
+#include "AddressTable.h"
+
+//Location of one return address
+struct Symbol
+{
+	void* address;
+	//File name, owned by the cache, nullptr until the address is resolved
+	char* file;
+	int line;
+};
+
+//Report entries share few call sites, so symbols are looked up once per
+//address and kept. Addresses can be added up front and resolved in one pass,
+//on Linux that pass can hand every address of a module to a single addr2line
+//run when HEAPDEBUGGER_ADDR2LINE names the program to use.
+//The cache is not thread safe, the caller serializes it.
+class SymbolCache
+{
+public:
+	SymbolCache();
+	~SymbolCache();
+
+	//Remember an address for the next Resolve, nothing happens if it is known
+	void Add(void* address, bool deleteError);
+	//Resolve every added address that is not known yet
+	void Resolve();
+	//Location of an address, resolved now if it is not known yet
+	const Symbol& Lookup(void* address, bool deleteError);
+	//Forget every symbol
+	void Clear();
+
+private:
+	//Resolve one address with the platform symbol functions
+	static void ResolveOne(Symbol& symbol, bool deleteError);
+
+	#if !defined (_MSC_VER)
+	//Resolve the pending addresses of both tables with addr2line, one run per module
+	void ResolveWithAddr2Line(const char* program);
+	#endif
+
+	//Disable copying, the cache owns its file names
+	SymbolCache(const SymbolCache&);
+	SymbolCache& operator=(const SymbolCache&);
+
+	//Symbols of leaks and of failed deletes, the platform functions resolve
+	//them differently
+	AddressTable<Symbol> tables_[2];
+	//Location that is not cached, of a null address or of one the table had
+	//no room for
+	Symbol unknown_[2];
+};
+
+#endif // SYMBOLCACHE_H
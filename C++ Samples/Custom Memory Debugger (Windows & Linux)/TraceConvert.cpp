@@ -0,0 +1,254 @@
+/*
+* ==============================================================
+* File   : TraceConvert.cpp
+* Purpose: Offline tool that turns a binary allocation trace of
+		   the heap debugger into CSV or a summary report
+  Author : Rohit Saini
+* Date   : 11/2022
+* All code is Copyrighted to owner, Rohit Saini
+* ==============================================================
+*/
+
+//Build on its own, it does not link the debugger:
+//  g++ -O2 -std=c++17 TraceConvert.cpp -o TraceConvert
+//Usage:
+//  TraceConvert <trace file> csv       every record, plus the leaks, as DebugLog.csv columns
+//  TraceConvert <trace file> summary   totals, size histogram and top call sites
+//The output goes to stdout.
+
+#include "TraceFormat.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+//Names of the MemoryType of a record
+static const char* TYPE_NAMES[] = { "Single Block", "Array", "Aligned Single Block", "Aligned Array" };
+
+//Name of the type of a record
+static const char* TypeName(const TraceRecord& record)
+{
+	return record.type < 4 ? TYPE_NAMES[record.type] : "Unknown";
+}
+
+//Allocation that is live at some point of the replay
+struct LiveAllocation
+{
+	uint64_t size;
+	uint64_t returnAddress;
+};
+
+//Totals of one call site
+struct CallSite
+{
+	uint64_t returnAddress;
+	uint64_t count;
+	uint64_t bytes;
+};
+
+//Read the header and every written record of a trace
+static bool ReadTrace(const char* path, TraceHeader& header, std::vector<TraceRecord>& records)
+{
+	FILE* file = fopen(path, "rb");
+	if (file == nullptr)
+	{
+		fprintf(stderr, "cannot open %s\n", path);
+		return false;
+	}
+
+	if (fread(&header, sizeof(header), 1, file) != 1 || memcmp(header.magic, TRACE_MAGIC, sizeof(TRACE_MAGIC)) != 0)
+	{
+		fprintf(stderr, "%s is not an allocation trace\n", path);
+		fclose(file);
+		return false;
+	}
+
+	if (header.version != TRACE_VERSION || header.recordSize != sizeof(TraceRecord))
+	{
+		fprintf(stderr, "%s has trace version %u, this tool reads version %d\n", path, header.version, TRACE_VERSION);
+		fclose(file);
+		return false;
+	}
+
+	//a trace that was not stopped has no count, then every slot is read
+	uint64_t count = header.count ? header.count : header.capacity;
+
+	TraceRecord chunk[4096];
+	while (count > 0)
+	{
+		size_t wanted = count < 4096 ? static_cast<size_t>(count) : 4096;
+		size_t got = fread(chunk, sizeof(TraceRecord), wanted, file);
+
+		//slots that were reserved but never finished are skipped
+		for (size_t i = 0; i < got; i++)
+			if (chunk[i].event != TRACE_NONE)
+				records.push_back(chunk[i]);
+
+		if (got < wanted)
+			break;
+		count -= got;
+	}
+
+	fclose(file);
+
+	//threads write their own blocks of the file, so put the records back in
+	//the order they happened before replaying them
+	std::stable_sort(records.begin(), records.end(),
+		[](const TraceRecord& a, const TraceRecord& b) { return a.timestamp < b.timestamp; });
+
+	return true;
+}
+
+//Write the records with the columns of DebugLog.csv
+static void WriteCSV(const std::vector<TraceRecord>& records)
+{
+	std::unordered_map<uint64_t, const TraceRecord*> live;
+
+	printf("Message, File, Line, Bytes, Address, Additional Info\n");
+
+	for (const TraceRecord& record : records)
+	{
+		if (record.event == TRACE_ALLOC)
+			live[record.address] = &record;
+		else
+			live.erase(record.address);
+
+		//the trace has no symbols, the file column holds the return address
+		printf("%s,0x%" PRIx64 ",0,%" PRIu64 ",0x%" PRIx64 ",%s thread %u at %" PRIu64 " ns\n",
+			record.event == TRACE_ALLOC ? "Allocation" : "Free", record.returnAddress, record.size, record.address,
+			TypeName(record), record.thread, record.timestamp);
+	}
+
+	//what was never freed, oldest first
+	std::vector<const TraceRecord*> leaks;
+	for (const auto& entry : live)
+		leaks.push_back(entry.second);
+
+	std::sort(leaks.begin(), leaks.end());
+
+	for (const TraceRecord* record : leaks)
+		printf("Memory Leak,0x%" PRIx64 ",0,%" PRIu64 ",0x%" PRIx64 ",%s thread %u at %" PRIu64 " ns\n",
+			record->returnAddress, record->size, record->address, TypeName(*record),
+			record->thread, record->timestamp);
+}
+
+//Write totals, a size histogram and the call sites holding the most memory
+static void WriteSummary(const TraceHeader& header, const std::vector<TraceRecord>& records)
+{
+	std::unordered_map<uint64_t, LiveAllocation> live;
+	uint64_t allocations = 0, frees = 0, unknownFrees = 0;
+	uint64_t allocatedBytes = 0, liveBytes = 0, peakBytes = 0, peakCount = 0;
+	uint64_t sizes[65] = {};
+	uint32_t threads = 0;
+
+	for (const TraceRecord& record : records)
+	{
+		threads = std::max(threads, record.thread);
+
+		if (record.event == TRACE_ALLOC)
+		{
+			allocations++;
+			allocatedBytes += record.size;
+
+			//bucket b holds sizes from 2^(b-1) up to 2^b - 1
+			int bucket = 0;
+			while (bucket < 64 && (record.size >> bucket) != 0)
+				bucket++;
+			sizes[bucket]++;
+
+			LiveAllocation allocation = { record.size, record.returnAddress };
+			live[record.address] = allocation;
+			liveBytes += record.size;
+
+			if (liveBytes > peakBytes)
+			{
+				peakBytes = liveBytes;
+				peakCount = live.size();
+			}
+		}
+		else
+		{
+			frees++;
+
+			auto found = live.find(record.address);
+			if (found == live.end())
+			{
+				//allocated before the trace was started
+				unknownFrees++;
+				continue;
+			}
+
+			liveBytes -= found->second.size;
+			live.erase(found);
+		}
+	}
+
+	//from the first to the last timestamp, whatever order the records are in
+	uint64_t duration = 0;
+	if (!records.empty())
+	{
+		auto range = std::minmax_element(records.begin(), records.end(),
+			[](const TraceRecord& a, const TraceRecord& b) { return a.timestamp < b.timestamp; });
+		duration = range.second->timestamp - range.first->timestamp;
+	}
+
+	printf("records:          %" PRIu64 " (%" PRIu64 " dropped)\n", static_cast<uint64_t>(records.size()), header.dropped);
+	printf("duration:         %.3f ms\n", duration / 1e6);
+	printf("threads:          %u\n", threads);
+	printf("allocations:      %" PRIu64 " (%" PRIu64 " bytes)\n", allocations, allocatedBytes);
+	printf("frees:            %" PRIu64 " (%" PRIu64 " of memory allocated before the trace)\n", frees, unknownFrees);
+	printf("peak live:        %" PRIu64 " bytes in %" PRIu64 " allocations\n", peakBytes, peakCount);
+	printf("live at the end:  %" PRIu64 " bytes in %" PRIu64 " allocations\n", liveBytes, static_cast<uint64_t>(live.size()));
+
+	printf("\nallocation sizes:\n");
+	for (int bucket = 0; bucket <= 64; bucket++)
+		if (sizes[bucket] != 0)
+			printf("  %20" PRIu64 " - %-20" PRIu64 " %" PRIu64 "\n", bucket ? uint64_t(1) << (bucket - 1) : 0,
+				bucket == 0 ? 0 : bucket == 64 ? UINT64_MAX : (uint64_t(1) << bucket) - 1, sizes[bucket]);
+
+	//group what is still live by call site
+	std::unordered_map<uint64_t, CallSite> sites;
+	for (const auto& entry : live)
+	{
+		CallSite& site = sites[entry.second.returnAddress];
+		site.returnAddress = entry.second.returnAddress;
+		site.count++;
+		site.bytes += entry.second.size;
+	}
+
+	std::vector<CallSite> top;
+	for (const auto& entry : sites)
+		top.push_back(entry.second);
+
+	std::sort(top.begin(), top.end(), [](const CallSite& a, const CallSite& b) { return a.bytes > b.bytes; });
+
+	printf("\ncall sites holding the most live memory:\n");
+	for (size_t i = 0; i < top.size() && i < 20; i++)
+		printf("  0x%016" PRIx64 "  %12" PRIu64 " bytes in %" PRIu64 " allocations\n", top[i].returnAddress, top[i].bytes,
+			top[i].count);
+}
+
+int main(int argc, char** argv)
+{
+	if (argc != 3 || (strcmp(argv[2], "csv") != 0 && strcmp(argv[2], "summary") != 0))
+	{
+		fprintf(stderr, "usage: %s <trace file> csv|summary\n", argv[0]);
+		return 1;
+	}
+
+	TraceHeader header;
+	std::vector<TraceRecord> records;
+
+	if (!ReadTrace(argv[1], header, records))
+		return 1;
+
+	if (strcmp(argv[2], "csv") == 0)
+		WriteCSV(records);
+	else
+		WriteSummary(header, records);
+
+	return 0;
+}
@@ -0,0 +1,69 @@
+/*
+* ==============================================================
+* File   : TraceFormat.h
+* Purpose: Layout of the binary allocation trace, shared by the
+		   heap debugger and the offline TraceConvert tool
+  Author : Rohit Saini
+* Date   : 11/2022
+* All code is Copyrighted to owner, Rohit Saini
+* ==============================================================
+*/
+
+#ifndef TRACEFORMAT_H
+#define TRACEFORMAT_H
+
+#include <cstdint>
+
+//A trace file is one TraceHeader followed by 'capacity' TraceRecords. The
+//file is sized up front and starts zeroed, a record whose event is
+//TRACE_NONE has not been written.
+
+//"HDTRACE" and a zero, the first bytes of every trace file
+#define TRACE_MAGIC "HDTRACE"
+//Bumped whenever the layout changes
+#define TRACE_VERSION 1
+
+//what a record describes
+enum TraceEvent
+{
+	TRACE_NONE = 0,
+	TRACE_ALLOC = 1,
+	TRACE_FREE = 2
+};
+
+//start of the file
+struct TraceHeader
+{
+	char magic[8];
+	uint32_t version;
+	//sizeof(TraceRecord) of the writer
+	uint32_t recordSize;
+	//number of record slots in the file
+	uint64_t capacity;
+	//number of records written, filled in when the trace is stopped
+	uint64_t count;
+	//records that did not fit in the file
+	uint64_t dropped;
+};
+
+//one allocation or free
+struct TraceRecord
+{
+	//nanoseconds since the trace was started
+	uint64_t timestamp;
+	uint64_t address;
+	uint64_t size;
+	uint64_t returnAddress;
+	//small number of the thread, in the order threads were first seen
+	uint32_t thread;
+	//TraceEvent, written last
+	uint8_t event;
+	//MemoryType, 0 for single block, 1 for array, 2 and 3 for their aligned forms
+	uint8_t type;
+	uint16_t reserved;
+};
+
+static_assert(sizeof(TraceHeader) == 40, "trace header layout");
+static_assert(sizeof(TraceRecord) == 40, "trace record layout");
+
+#endif // TRACEFORMAT_H
@@ -0,0 +1,315 @@
+/*
+* ==============================================================
+* File   : TraceWriter.cpp
+* Purpose: Appends binary allocation records to a memory mapped,
+		   pre-sized trace file for the heap debugger
+  Author : Rohit Saini
+* Date   : 11/2022
+* All code is Copyrighted to owner, Rohit Saini
+* ==============================================================
+*/
+
+#include "TraceWriter.h"
+#include "SpinLock.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <thread>
+
+//include OS Specific functions only
+#if defined (_MSC_VER)
+#include <windows.h>
+
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#endif
+
+//Slots a thread reserves at once, so threads rarely touch next_
+static const uint64_t BLOCK_RECORDS = 64;
+
+//Per thread state of Record. Never freed, the state of an exited thread is
+//taken over by a new thread, so Stop can walk the list without a lock.
+struct TraceThread
+{
+	TraceThread() : busy(false), retired(false), run(0), next(0), end(0), link(nullptr) {}
+
+	//Whether the thread is inside Record, Stop waits for it before unmapping
+	std::atomic<bool> busy;
+	//Whether the thread exited and the state can be taken over
+	std::atomic<bool> retired;
+	//Trace the block was reserved in, and the slots of the block left
+	uint64_t run;
+	uint64_t next;
+	uint64_t end;
+	//Next state of the list
+	TraceThread* link;
+};
+
+//States of all threads that recorded, newest first, constant initialized
+static std::atomic<TraceThread*> trace_threads(nullptr);
+static SpinLock trace_threads_lock;
+//Traces started so far
+static std::atomic<uint64_t> trace_runs(0);
+
+//State of the calling thread, and whether the thread is exiting
+static thread_local TraceThread* trace_thread = nullptr;
+static thread_local bool trace_thread_exited = false;
+
+//Retires the state of a thread when the thread exits
+struct TraceThreadRetirer {
+	//only set, so that using the thread_local constructs it and registers
+	//its destructor for the thread
+	bool armed = false;
+
+	~TraceThreadRetirer()
+	{
+		if (trace_thread != nullptr)
+			trace_thread->retired.store(true, std::memory_order_release);
+
+		trace_thread = nullptr;
+		trace_thread_exited = true;
+	}
+};
+static thread_local TraceThreadRetirer trace_thread_retirer;
+
+//Take over the state of an exited thread, or add a new one
+static TraceThread* AcquireTraceThread()
+{
+	for (TraceThread* thread = trace_threads.load(std::memory_order_acquire); thread != nullptr; thread = thread->link)
+	{
+		bool retired = true;
+		if (thread->retired.load(std::memory_order_relaxed) &&
+			thread->retired.compare_exchange_strong(retired, false, std::memory_order_acq_rel))
+			return thread;
+	}
+
+	//malloc'ed, recording must not come back into operator new
+	void* memory = malloc(sizeof(TraceThread));
+	if (memory == nullptr)
+		return nullptr;
+
+	TraceThread* thread = new (memory) TraceThread();
+
+	SpinLockGuard guard(trace_threads_lock);
+	thread->link = trace_threads.load(std::memory_order_relaxed);
+	trace_threads.store(thread, std::memory_order_release);
+
+	return thread;
+}
+
+TraceWriter::TraceWriter() :
+	active_(false), next_(0), dropped_(0), run_(0), header_(nullptr), records_(nullptr), capacity_(0),
+	mappedBytes_(0)
+{
+	#if defined (_MSC_VER)
+	file_ = INVALID_HANDLE_VALUE;
+	mapping_ = nullptr;
+	#else
+	file_ = -1;
+	#endif
+}
+
+TraceWriter::~TraceWriter()
+{
+	Stop();
+}
+
+//Create the file with room for 'capacity' records and map it
+bool TraceWriter::Start(const char* path, size_t capacity)
+{
+	if (header_ != nullptr || capacity == 0)
+		return false;
+
+	size_t bytes = sizeof(TraceHeader) + capacity * sizeof(TraceRecord);
+	void* memory = nullptr;
+
+	#if defined (_MSC_VER)
+		HANDLE file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS,
+			FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+			return false;
+
+		//the mapping sizes the file, new pages read as zero
+		HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READWRITE, static_cast<DWORD>(static_cast<uint64_t>(bytes) >> 32),
+			static_cast<DWORD>(bytes), nullptr);
+		if (mapping != nullptr)
+			memory = MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, bytes);
+
+		if (memory == nullptr)
+		{
+			if (mapping != nullptr)
+				CloseHandle(mapping);
+			CloseHandle(file);
+			return false;
+		}
+
+		file_ = file;
+		mapping_ = mapping;
+	#else
+		int file = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+		if (file < 0)
+			return false;
+
+		//a truncated file reads as zeros, so every record starts as TRACE_NONE
+		if (ftruncate(file, static_cast<off_t>(bytes)) == 0)
+			memory = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+
+		if (memory == nullptr || memory == MAP_FAILED)
+		{
+			close(file);
+			return false;
+		}
+
+		file_ = file;
+	#endif
+
+	header_ = static_cast<TraceHeader*>(memory);
+	records_ = reinterpret_cast<TraceRecord*>(header_ + 1);
+	capacity_ = capacity;
+	mappedBytes_ = bytes;
+
+	memcpy(header_->magic, TRACE_MAGIC, sizeof(header_->magic));
+	header_->version = TRACE_VERSION;
+	header_->recordSize = sizeof(TraceRecord);
+	header_->capacity = capacity;
+	header_->count = 0;
+	header_->dropped = 0;
+
+	next_.store(0);
+	dropped_.store(0);
+	run_ = trace_runs.fetch_add(1) + 1;
+	start_ = std::chrono::steady_clock::now();
+	active_.store(true, std::memory_order_release);
+
+	return true;
+}
+
+//Write the header, unmap and close the file
+void TraceWriter::Stop()
+{
+	if (header_ == nullptr)
+		return;
+
+	//no new records, and wait for the ones being written. The fence pairs
+	//with the one in Record, so either this thread sees a writer busy or
+	//the writer sees that the trace was stopped.
+	active_.store(false, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+
+	for (TraceThread* thread = trace_threads.load(std::memory_order_acquire); thread != nullptr; thread = thread->link)
+	{
+		while (thread->busy.load(std::memory_order_acquire))
+			std::this_thread::yield();
+	}
+
+	uint64_t count = next_.load();
+	header_->count = count < capacity_ ? count : capacity_;
+	header_->dropped = dropped_.load();
+
+	#if defined (_MSC_VER)
+		FlushViewOfFile(header_, 0);
+		UnmapViewOfFile(header_);
+		CloseHandle(mapping_);
+		CloseHandle(file_);
+		mapping_ = nullptr;
+		file_ = INVALID_HANDLE_VALUE;
+	#else
+		msync(header_, mappedBytes_, MS_SYNC);
+		munmap(header_, mappedBytes_);
+		close(file_);
+		file_ = -1;
+	#endif
+
+	header_ = nullptr;
+	records_ = nullptr;
+	capacity_ = 0;
+}
+
+//Slot for the next record of the calling thread, from its block or a new one
+bool TraceWriter::ReserveSlot(TraceThread* thread, uint64_t& slot)
+{
+	if (thread->run != run_ || thread->next == thread->end)
+	{
+		uint64_t first = next_.fetch_add(BLOCK_RECORDS, std::memory_order_relaxed);
+
+		//the slots of the last block past the capacity are never written
+		thread->run = run_;
+		thread->next = first < capacity_ ? first : capacity_;
+		thread->end = first + BLOCK_RECORDS < capacity_ ? first + BLOCK_RECORDS : capacity_;
+
+		if (thread->next == thread->end)
+			return false;
+	}
+
+	slot = thread->next++;
+	return true;
+}
+
+//Append one record
+void TraceWriter::Record(TraceEvent event, void* address, size_t size, void* returnAddress, int type)
+{
+	TraceThread* thread = trace_thread;
+
+	if (thread == nullptr)
+	{
+		thread = AcquireTraceThread();
+		if (thread == nullptr)
+		{
+			dropped_.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+
+		//a thread that is exiting only borrows a state for this record
+		if (!trace_thread_exited)
+		{
+			trace_thread_retirer.armed = true;
+			trace_thread = thread;
+		}
+	}
+
+	//the fence pairs with the one in Stop
+	thread->busy.store(true, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+
+	if (active_.load(std::memory_order_acquire))
+	{
+		uint64_t slot;
+
+		if (ReserveSlot(thread, slot))
+		{
+			TraceRecord& record = records_[slot];
+			record.timestamp = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+				std::chrono::steady_clock::now() - start_).count());
+			record.address = reinterpret_cast<uintptr_t>(address);
+			record.size = size;
+			record.returnAddress = reinterpret_cast<uintptr_t>(returnAddress);
+			record.thread = ThreadNumber();
+			record.type = static_cast<uint8_t>(type);
+			record.reserved = 0;
+
+			//the event marks the record as complete, so it goes in last
+			std::atomic_thread_fence(std::memory_order_release);
+			record.event = static_cast<uint8_t>(event);
+		}
+		else
+			dropped_.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	thread->busy.store(false, std::memory_order_release);
+
+	if (thread != trace_thread)
+		thread->retired.store(true, std::memory_order_release);
+}
+
+//Small number of the calling thread
+uint32_t TraceWriter::ThreadNumber()
+{
+	static std::atomic<uint32_t> threads(0);
+	static thread_local uint32_t number = threads.fetch_add(1) + 1;
+
+	return number;
+}
@@ -0,0 +1,83 @@
+/*
+* ==============================================================
+* File   : TraceWriter.h
+* Purpose: Appends binary allocation records to a memory mapped,
+		   pre-sized trace file for the heap debugger
+  Author : Rohit Saini
+* Date   : 11/2022
+* All code is Copyrighted to owner, Rohit Saini
+* ==============================================================
+*/
+
+#ifndef TRACEWRITER_H
+#define TRACEWRITER_H
+
+#include "TraceFormat.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+
+//Per thread state of Record
+struct TraceThread;
+
+//Writes fixed size TraceRecords straight into a mapped file. Each thread
+//reserves slots in blocks, so recording a record is mostly a 40 byte copy
+//into the thread's block, nothing is formatted and nothing is allocated.
+//Records of different threads are not in time order in the file, the
+//converter sorts them by timestamp. The file can be converted with TraceConvert.
+class TraceWriter
+{
+public:
+	TraceWriter();
+	~TraceWriter();
+
+	//Create the file with room for 'capacity' records and map it
+	bool Start(const char* path, size_t capacity);
+	//Write the header, unmap and close the file
+	void Stop();
+
+	//Whether a trace is being written
+	bool IsActive() const { return active_.load(std::memory_order_relaxed); }
+
+	//Append one record, records past the capacity are counted and dropped
+	void Record(TraceEvent event, void* address, size_t size, void* returnAddress, int type);
+
+private:
+	//Small number of the calling thread
+	static uint32_t ThreadNumber();
+
+	//Slot for the next record of the calling thread, false if the trace is full
+	bool ReserveSlot(TraceThread* thread, uint64_t& slot);
+
+	//Disable copying
+	TraceWriter(const TraceWriter&);
+	TraceWriter& operator=(const TraceWriter&);
+
+	//Whether Record writes anything
+	std::atomic<bool> active_;
+	//Next record slot to hand out, a block at a time
+	std::atomic<uint64_t> next_;
+	//Records that did not fit
+	std::atomic<uint64_t> dropped_;
+	//Number of this trace among all traces started, blocks reserved in an
+	//earlier trace are not used
+	uint64_t run_;
+
+	//The mapped file
+	TraceHeader* header_;
+	TraceRecord* records_;
+	size_t capacity_;
+	size_t mappedBytes_;
+	//Time the trace was started
+	std::chrono::steady_clock::time_point start_;
+
+	#if defined (_MSC_VER)
+	void* file_;
+	void* mapping_;
+	#else
+	int file_;
+	#endif
+};
+
+#endif // TRACEWRITER_H
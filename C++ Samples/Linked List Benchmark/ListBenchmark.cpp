@@ -0,0 +1,321 @@
+/*****************************************************************************/
+/*!
+\file   ListBenchmark.cpp
+\author Rohit Saini
+\par    email: rohitsaini429@gmail.com
+
+\brief
+    Microbenchmark for the templated Linked List (List) and the linked
+    list of arrays (Lariat). For every container, item size and item count
+    it measures the time and the number of heap allocations per operation
+    of push_front, push_back, pop_front, operator[], copying, operator+
+    (List only) and clear. Allocations are counted by replacing the global
+    operator new.
+
+    The results are written to stdout as CSV (default) or JSON (--json),
+    one row per measurement, so runs of two releases can be diffed.
+
+    Build (from this folder):
+
+      g++ -O2 -std=c++17 -pthread -I"../Templated Linked List"
+          -I"../Templated Linked List Of Arrays" ListBenchmark.cpp
+          -o ListBenchmark
+
+    Options:
+
+      --json           write JSON instead of CSV
+      --max-n N        largest item count to run (default 10000000)
+      --max-bytes B    skip runs whose items take more than B bytes
+                       (default 1073741824)
+*/
+/*****************************************************************************/
+#include <chrono>    /* steady_clock */
+#include <cstdio>    /* printf */
+#include <cstdlib>   /* malloc, free, strtol */
+#include <cstring>   /* memset, strcmp */
+#include <iostream>  /* ostream, used by the containers */
+#include <new>       /* bad_alloc */
+
+#include "List.h"
+#include "lariat.h"
+
+//Counted by the global operator new below
+static unsigned long long g_allocations = 0;
+static unsigned long long g_allocatedBytes = 0;
+
+//The replacements below are never inlined, otherwise the compiler sees a
+//new expression's memory reach free() and warns about the mismatch
+#if defined (_MSC_VER)
+#define BENCHMARK_NOINLINE __declspec(noinline)
+#else
+#define BENCHMARK_NOINLINE __attribute__((noinline))
+#endif
+
+//Every allocation in the program goes through here and is counted
+BENCHMARK_NOINLINE void* operator new(std::size_t size)
+{
+  g_allocations++;
+  g_allocatedBytes += size;
+
+  if (void* memory = std::malloc(size ? size : 1))
+    return memory;
+
+  throw std::bad_alloc();
+}
+
+BENCHMARK_NOINLINE void operator delete(void* address) noexcept
+{
+  std::free(address);
+}
+
+BENCHMARK_NOINLINE void operator delete(void* address, std::size_t) noexcept
+{
+  std::free(address);
+}
+
+//! Item of a fixed size, so the containers can be measured per item size
+template <int Bytes>
+struct Payload
+{
+  Payload(int value = 0) { std::memset(bytes, value & 0xff, Bytes); }
+
+  bool operator==(const Payload& rhs) const { return bytes[0] == rhs.bytes[0]; }
+
+  char bytes[Bytes];
+};
+
+//! Number of elements of the Lariat nodes
+static const int LARIAT_SIZE = 64;
+
+//! Written to so the compiler can not drop the measured work
+static volatile int g_sink = 0;
+
+//! Output format
+static bool g_json = false;
+
+//! true until the first JSON row has been written
+static bool g_firstRow = true;
+
+/**************************************************************************/
+/*!
+  \brief
+    Takes a snapshot of the clock and allocation counters, and reports the
+    difference as one row when it is stopped.
+*/
+/**************************************************************************/
+class Measurement
+{
+  public:
+
+    //! Starts the measurement
+    Measurement(const char* container, const char* op, int itemBytes, long count)
+      : container_(container), op_(op), itemBytes_(itemBytes), count_(count),
+        allocations_(g_allocations), bytes_(g_allocatedBytes),
+        start_(std::chrono::steady_clock::now())
+    {
+    }
+
+    //! Stops the measurement and writes the row, ops is the number of
+    //! operations (or items) the time is divided by
+    void stop(long ops)
+    {
+      std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+      double ns = std::chrono::duration<double, std::nano>(end - start_).count();
+      double perOp = ops > 0 ? 1.0 / ops : 0.0;
+
+      Report(ns * perOp, (g_allocations - allocations_) * perOp,
+             (g_allocatedBytes - bytes_) * perOp, ops);
+    }
+
+  private:
+
+    //! Writes one row as CSV or JSON
+    void Report(double nsPerOp, double allocsPerOp, double bytesPerOp, long ops)
+    {
+      if (g_json)
+      {
+        std::printf("%s\n  {\"container\": \"%s\", \"op\": \"%s\", \"item_bytes\": %d, "
+                    "\"n\": %ld, \"ops\": %ld, \"ns_per_op\": %.3f, "
+                    "\"allocs_per_op\": %.4f, \"bytes_per_op\": %.2f}",
+                    g_firstRow ? "" : ",", container_, op_, itemBytes_, count_, ops,
+                    nsPerOp, allocsPerOp, bytesPerOp);
+        g_firstRow = false;
+      }
+      else
+        std::printf("%s,%s,%d,%ld,%ld,%.3f,%.4f,%.2f\n", container_, op_, itemBytes_,
+                    count_, ops, nsPerOp, allocsPerOp, bytesPerOp);
+
+      std::fflush(stdout);
+    }
+
+    const char* container_;
+    const char* op_;
+    int itemBytes_;
+    long count_;
+    unsigned long long allocations_;
+    unsigned long long bytes_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+//! operator+ is only measured for List, Lariat does not have it
+template <typename T, typename Alloc, int InlineNodes>
+void MeasureConcat(const char* name, const List<T, Alloc, InlineNodes>& a,
+                   const List<T, Alloc, InlineNodes>& b, long n)
+{
+  Measurement m(name, "operator+", sizeof(T), n);
+  List<T, Alloc, InlineNodes> sum = a + b;
+  m.stop(2 * n);
+
+  g_sink = sum.size();
+}
+
+template <typename T, int Size>
+void MeasureConcat(const char*, const Lariat<T, Size>&, const Lariat<T, Size>&, long)
+{
+}
+
+//! Number of operator[] calls, both containers walk to the index so large
+//! lists get fewer calls to keep the run time reasonable
+static long SubscriptCalls(long n)
+{
+  long calls = 100000000L / n;
+
+  return calls < 10 ? 10 : calls > 10000 ? 10000 : calls;
+}
+
+/**************************************************************************/
+/*!
+  \brief
+    Runs every operation on one container type for one item count. Copy,
+    operator+ and clear are reported per item.
+
+  \param name
+    The name of the container in the output.
+
+  \param n
+    The number of items to put in the container.
+*/
+/**************************************************************************/
+template <typename Container, typename T>
+void RunSuite(const char* name, long n)
+{
+  Container c;
+
+  //push_back of n items
+  {
+    Measurement m(name, "push_back", sizeof(T), n);
+    for (long i = 0; i < n; i++)
+      c.push_back(T(static_cast<int>(i)));
+    m.stop(n);
+  }
+
+  //operator[] at pseudo random positions
+  {
+    long calls = SubscriptCalls(n);
+    unsigned seed = 12345;
+    int sum = 0;
+
+    Measurement m(name, "operator[]", sizeof(T), n);
+    for (long i = 0; i < calls; i++)
+    {
+      seed = seed * 1103515245u + 12345u;
+      sum += c[static_cast<int>(seed % static_cast<unsigned>(n))].bytes[0];
+    }
+    m.stop(calls);
+
+    g_sink = sum;
+  }
+
+  //copy constructor, then operator+ and clear on the copy
+  {
+    Measurement copyTime(name, "copy", sizeof(T), n);
+    Container copy(c);
+    copyTime.stop(n);
+
+    MeasureConcat(name, c, copy, n);
+
+    Measurement clearTime(name, "clear", sizeof(T), n);
+    copy.clear();
+    clearTime.stop(n);
+  }
+
+  //pop_front until empty
+  {
+    Measurement m(name, "pop_front", sizeof(T), n);
+    for (long i = 0; i < n; i++)
+      c.pop_front();
+    m.stop(n);
+  }
+
+  //push_front of n items
+  {
+    Container f;
+
+    Measurement m(name, "push_front", sizeof(T), n);
+    for (long i = 0; i < n; i++)
+      f.push_front(T(static_cast<int>(i)));
+    m.stop(n);
+  }
+}
+
+/**************************************************************************/
+/*!
+  \brief
+    Runs both containers for one item size and every item count from 1000
+    up to maxN, skipping counts whose items would not fit in maxBytes.
+*/
+/**************************************************************************/
+template <int Bytes>
+void RunSize(long maxN, unsigned long long maxBytes)
+{
+  typedef Payload<Bytes> T;
+
+  for (long n = 1000; n <= maxN; n *= 10)
+  {
+    //The copy and operator+ hold up to four lists of n items at once.
+    if (4ULL * n * sizeof(T) > maxBytes)
+      break;
+
+    RunSuite<List<T>, T>("List", n);
+    RunSuite<Lariat<T, LARIAT_SIZE>, T>("Lariat", n);
+  }
+}
+
+int main(int argc, char** argv)
+{
+  long maxN = 10000000L;
+  unsigned long long maxBytes = 1ULL << 30;
+
+  //Read the options
+  for (int i = 1; i < argc; i++)
+  {
+    if (std::strcmp(argv[i], "--json") == 0)
+      g_json = true;
+    else if (std::strcmp(argv[i], "--max-n") == 0 && i + 1 < argc)
+      maxN = std::strtol(argv[++i], 0, 10);
+    else if (std::strcmp(argv[i], "--max-bytes") == 0 && i + 1 < argc)
+      maxBytes = std::strtoull(argv[++i], 0, 10);
+    else
+    {
+      std::fprintf(stderr, "usage: %s [--json] [--max-n N] [--max-bytes B]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  //Header
+  if (g_json)
+    std::printf("[");
+  else
+    std::printf("container,op,item_bytes,n,ops,ns_per_op,allocs_per_op,bytes_per_op\n");
+
+  RunSize<4>(maxN, maxBytes);
+  RunSize<16>(maxN, maxBytes);
+  RunSize<64>(maxN, maxBytes);
+  RunSize<256>(maxN, maxBytes);
+
+  if (g_json)
+    std::printf("\n]\n");
+
+  return 0;
+}
@@ -645,7 +645,13 @@ void Lariat<T, Size>::pop_front()
     {
         LNode* toDelete = head_;
         head_ = head_->next;
-        head_->prev = nullptr;
+
+        //removing the last node leaves an empty list
+        if (head_)
+            head_->prev = nullptr;
+        else
+            tail_ = nullptr;
+
         delete toDelete;
 
         nodecount_--;
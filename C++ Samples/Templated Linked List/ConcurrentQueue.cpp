@@ -0,0 +1,531 @@
+/*****************************************************************************/
+/*!
+\file   ConcurrentQueue.cpp
+\author Rohit Saini
+\par    email: rohitsaini429@gmail.com
+\brief
+    This file contains the implementation of the following functions for
+    the lock-free queues.
+
+    Functions include:
+
+      + MPSCQueue
+      + ~MPSCQueue
+      + MPSCQueue::push_back
+      + MPSCQueue::pop_front
+      + MPSCQueue::try_pop_front
+      + MPSCQueue::front
+      + MPSCQueue::empty
+      + MPSCQueue::acquire_node
+      + MPSCQueue::release_node
+      + MPSCQueue::node_at
+      + MPSCQueue::chunk_slot
+      + SPSCQueue(capacity)
+      + ~SPSCQueue
+      + SPSCQueue::push_back
+      + SPSCQueue::pop_front
+      + SPSCQueue::try_pop_front
+      + SPSCQueue::front
+      + SPSCQueue::empty
+*/
+/*****************************************************************************/
+
+/**************************************************************************/
+/*!
+  \brief
+    Initializes an empty queue. The queue always holds one stub node
+    before the first item, so producers never have to touch head_.
+
+  \param max_nodes
+    The most nodes the queue may ever allocate, rounded up to whole chunks.
+    Node indices are 32 bits wide, which also caps it.
+*/
+/**************************************************************************/
+template <typename T>
+MPSCQueue<T>::MPSCQueue(unsigned max_nodes) : free_(0), used_(0)
+{
+  //Whole chunks, index 0 is never used so the last chunk of the 32 bit
+  //index range can not be reached.
+  max_chunks_ = max_nodes / CHUNK_SIZE + (max_nodes % CHUNK_SIZE ? 1 : 0);
+  if (max_chunks_ == 0)
+    max_chunks_ = 1;
+  if (max_chunks_ > 0xffffffffu / CHUNK_SIZE)
+    max_chunks_ = 0xffffffffu / CHUNK_SIZE;
+
+  //Only the page pointers are allocated now, 512 bytes for the default cap.
+  page_count_ = (max_chunks_ + PAGE_CHUNKS - 1) / PAGE_CHUNKS;
+  pages_ = new std::atomic<ChunkPage *>[page_count_];
+  for (unsigned i = 0; i < page_count_; i++)
+    pages_[i].store(0, std::memory_order_relaxed);
+
+  //Create the stub node that head and tail start at.
+  Node *stub = acquire_node();
+  stub->next.store(0, std::memory_order_relaxed);
+
+  head_ = stub;
+  tail_.store(stub, std::memory_order_relaxed);
+}
+
+/**************************************************************************/
+/*!
+  \brief
+    Destroys the items left in the queue and frees every chunk of nodes.
+*/
+/**************************************************************************/
+template <typename T>
+MPSCQueue<T>::~MPSCQueue()
+{
+  //Destroy the remaining items.
+  while (!empty())
+    pop_front();
+
+  //Free the node table and its directory.
+  for (unsigned i = 0; i < page_count_; i++)
+  {
+    ChunkPage *page = pages_[i].load(std::memory_order_relaxed);
+    if (!page)
+      continue;
+
+    for (unsigned j = 0; j < PAGE_CHUNKS; j++)
+      delete [] page->chunks[j].load(std::memory_order_relaxed);
+
+    delete page;
+  }
+
+  delete [] pages_;
+}
+
+/**************************************************************************/
+/*!
+  \brief
+    Adds an item to the end of the queue. Safe to call from any number of
+    threads at once, it costs one atomic exchange plus the free list pop.
+
+  \param value
+    The value of the new item.
+*/
+/**************************************************************************/
+template <typename T>
+void MPSCQueue<T>::push_back(const T& value)
+{
+  //Get a recycled node and construct the item in it.
+  Node *node = acquire_node();
+
+  try
+  {
+    new (&node->storage) T(value);
+  }
+  catch (...)
+  {
+    release_node(node);
+    throw;
+  }
+
+  node->next.store(0, std::memory_order_relaxed);
+
+  //Claim the tail, then link the previous tail to the new node. Until
+  //the link is stored the consumer sees the queue end at prev.
+  Node *prev = tail_.exchange(node, std::memory_order_acq_rel);
+  prev->next.store(node, std::memory_order_release);
+}
+
+/**************************************************************************/
+/*!
+  \brief
+    Removes the first item in the queue (if it exists). If the queue is
+    empty, nothing is done.
+*/
+/**************************************************************************/
+template <typename T>
+void MPSCQueue<T>::pop_front()
+{
+  Node *head = head_;
+  Node *next = head->next.load(std::memory_order_acquire);
+
+  //Only remove if the first item exists.
+  if (next)
+  {
+    //Destroy the item, its node becomes the new stub.
+    next->data().~T();
+    head_ = next;
+
+    //Recycle the old stub.
+    release_node(head);
+  }
+}
+
+/**************************************************************************/
+/*!
+  \brief
+    Moves the first item out of the queue and removes it.
+
+  \param value
+    Receives the first item.
+
+  \return
+    Returns true if an item was removed, false if the queue was empty.
+*/
+/**************************************************************************/
+template <typename T>
+bool MPSCQueue<T>::try_pop_front(T& value)
+{
+  Node *head = head_;
+  Node *next = head->next.load(std::memory_order_acquire);
+
+  //Nothing to remove.
+  if (!next)
+    return false;
+
+  //Move the item out and destroy it, its node becomes the new stub.
+  value = static_cast<T&&>(next->data());
+  next->data().~T();
+  head_ = next;
+
+  //Recycle the old stub.
+  release_node(head);
+
+  return true;
+}
+
+/**************************************************************************/
+/*!
+  \brief
+     Checks the value of the first item in the queue.
+
+  \return
+    Returns the value of the first item in the queue.
+*/
+/**************************************************************************/
+template <typename T>
+T MPSCQueue<T>::front() const
+{
+  //The first item lives in the node after the stub.
+  return head_->next.load(std::memory_order_acquire)->data();
+}
+
+/**************************************************************************/
+/*!
+  \brief
+     Checks whether the queue is empty or not. An item whose producer has
+     not finished linking it yet is not visible.
+
+  \return
+    Returns true if the queue is empty, and false if it is not.
+*/
+/**************************************************************************/
+template <typename T>
+bool MPSCQueue<T>::empty() const
+{
+  return head_->next.load(std::memory_order_acquire) == 0;
+}
+
+/**************************************************************************/
+/*!
+  \brief
+    Gets a node from the lock-free free list. The free list stores node
+    indices together with a tag that changes on every update, so a node
+    that is popped and pushed back while another thread is in the middle
+    of a pop cannot fool its compare-exchange (the ABA problem). If the
+    free list is empty, a never used node is taken from the node table.
+
+  \return
+    Returns a pointer to a node that is not on the queue.
+*/
+/**************************************************************************/
+template <typename T>
+typename MPSCQueue<T>::Node *MPSCQueue<T>::acquire_node()
+{
+  unsigned long long top = free_.load(std::memory_order_acquire);
+
+  //Try to pop the top of the free list.
+  while (static_cast<unsigned>(top))
+  {
+    Node *node = node_at(static_cast<unsigned>(top));
+    unsigned next = node->free_next.load(std::memory_order_relaxed);
+
+    //Bump the tag and make the next node the top.
+    unsigned long long newTop = (((top >> 32) + 1) << 32) | next;
+
+    if (free_.compare_exchange_weak(top, newTop, std::memory_order_acquire,
+                                    std::memory_order_acquire))
+      return node;
+  }
+
+  //The free list is empty, so hand out the next unused index.
+  unsigned index = used_.fetch_add(1, std::memory_order_relaxed) + 1;
+  unsigned chunk = (index - 1) / CHUNK_SIZE;
+
+  if (chunk >= max_chunks_)
+  {
+    //Give the index back so a failed push does not use up the count.
+    used_.fetch_sub(1, std::memory_order_relaxed);
+    throw std::bad_alloc();
+  }
+
+  //Allocate the chunk if no other thread has yet.
+  std::atomic<Node *> &slot = chunk_slot(chunk);
+  Node *nodes = slot.load(std::memory_order_acquire);
+  if (!nodes)
+  {
+    Node *fresh = new Node[CHUNK_SIZE];
+
+    //Number the nodes of the chunk.
+    for (unsigned i = 0; i < CHUNK_SIZE; i++)
+      fresh[i].index = chunk * CHUNK_SIZE + i + 1;
+
+    //Publish the chunk, the loser of a race frees its copy.
+    if (slot.compare_exchange_strong(nodes, fresh, std::memory_order_acq_rel))
+      nodes = fresh;
+    else
+      delete [] fresh;
+  }
+
+  return nodes + (index - 1) % CHUNK_SIZE;
+}
+
+/**************************************************************************/
+/*!
+  \brief
+    Pushes a node onto the lock-free free list.
+
+  \param node
+    The node to recycle, its item must already be destroyed.
+*/
+/**************************************************************************/
+template <typename T>
+void MPSCQueue<T>::release_node(Node *node)
+{
+  unsigned long long top = free_.load(std::memory_order_relaxed);
+  unsigned long long newTop;
+
+  //Link the node in front of the current top and bump the tag.
+  do
+  {
+    node->free_next.store(static_cast<unsigned>(top), std::memory_order_relaxed);
+    newTop = (((top >> 32) + 1) << 32) | node->index;
+  } while (!free_.compare_exchange_weak(top, newTop, std::memory_order_release,
+                                        std::memory_order_relaxed));
+}
+
+/**************************************************************************/
+/*!
+  \brief
+    Gets a node from the node table by its index.
+
+  \param index
+    The index of the node, starting at 1.
+
+  \return
+    Returns a pointer to the node.
+*/
+/**************************************************************************/
+template <typename T>
+typename MPSCQueue<T>::Node *MPSCQueue<T>::node_at(unsigned index) const
+{
+  unsigned chunk = (index - 1) / CHUNK_SIZE;
+
+  return pages_[chunk / PAGE_CHUNKS].load(std::memory_order_acquire)
+           ->chunks[chunk % PAGE_CHUNKS].load(std::memory_order_acquire)
+         + (index - 1) % CHUNK_SIZE;
+}
+
+/**************************************************************************/
+/*!
+  \brief
+    Gets the directory entry of a chunk. The page holding the entry is
+    allocated the first time any of its chunks is needed.
+
+  \param chunk
+    The number of the chunk, below max_chunks_.
+
+  \return
+    Returns the entry, which is null until the chunk is allocated.
+*/
+/**************************************************************************/
+template <typename T>
+std::atomic<typename MPSCQueue<T>::Node *> &MPSCQueue<T>::chunk_slot(unsigned chunk)
+{
+  std::atomic<ChunkPage *> &entry = pages_[chunk / PAGE_CHUNKS];
+  ChunkPage *page = entry.load(std::memory_order_acquire);
+
+  if (!page)
+  {
+    ChunkPage *fresh = new ChunkPage;
+    for (unsigned i = 0; i < PAGE_CHUNKS; i++)
+      fresh->chunks[i].store(0, std::memory_order_relaxed);
+
+    //Publish the page, the loser of a race frees its copy.
+    if (entry.compare_exchange_strong(page, fresh, std::memory_order_acq_rel))
+      page = fresh;
+    else
+      delete fresh;
+  }
+
+  return page->chunks[chunk % PAGE_CHUNKS];
+}
+
+/**************************************************************************/
+/*!
+  \brief
+    Initializes an empty ring that can hold at least capacity items.
+
+  \param capacity
+    The minimum number of items the queue can hold, at most MAX_CAPACITY.
+*/
+/**************************************************************************/
+template <typename T>
+SPSCQueue<T>::SPSCQueue(unsigned capacity)
+  : tail_(0), cached_head_(0), head_(0), cached_tail_(0)
+{
+  //The next power of 2 would not fit in an unsigned.
+  if (capacity > MAX_CAPACITY)
+    throw std::length_error("SPSCQueue capacity is too large");
+
+  //Round the capacity up to a power of 2 so positions wrap with a mask.
+  unsigned size = 1;
+  while (size < capacity)
+    size <<= 1;
+
+  slots_ = new Slot[size];
+  mask_ = size - 1;
+}
+
+/**************************************************************************/
+/*!
+  \brief
+    Destroys the items left in the queue and frees the ring.
+*/
+/**************************************************************************/
+template <typename T>
+SPSCQueue<T>::~SPSCQueue()
+{
+  //Destroy the remaining items.
+  while (!empty())
+    pop_front();
+
+  delete [] slots_;
+}
+
+/**************************************************************************/
+/*!
+  \brief
+    Adds an item to the end of the queue. The producer only reads the
+    consumer's position when its cached copy says the ring is full.
+
+  \param value
+    The value of the new item.
+
+  \return
+    Returns true if the item was added, false if the queue is full.
+*/
+/**************************************************************************/
+template <typename T>
+bool SPSCQueue<T>::push_back(const T& value)
+{
+  unsigned tail = tail_.load(std::memory_order_relaxed);
+
+  //Check for room, refreshing the consumer's position only if needed.
+  if (tail - cached_head_ > mask_)
+  {
+    cached_head_ = head_.load(std::memory_order_acquire);
+
+    if (tail - cached_head_ > mask_)
+      return false;
+  }
+
+  //Construct the item, then publish it to the consumer.
+  new (&slots_[tail & mask_]) T(value);
+  tail_.store(tail + 1, std::memory_order_release);
+
+  return true;
+}
+
+/**************************************************************************/
+/*!
+  \brief
+    Removes the first item in the queue (if it exists). If the queue is
+    empty, nothing is done.
+*/
+/**************************************************************************/
+template <typename T>
+void SPSCQueue<T>::pop_front()
+{
+  //Only remove if the first item exists.
+  if (!empty())
+  {
+    unsigned head = head_.load(std::memory_order_relaxed);
+
+    //Destroy the item, then give the slot back to the producer.
+    reinterpret_cast<T *>(&slots_[head & mask_])->~T();
+    head_.store(head + 1, std::memory_order_release);
+  }
+}
+
+/**************************************************************************/
+/*!
+  \brief
+    Moves the first item out of the queue and removes it.
+
+  \param value
+    Receives the first item.
+
+  \return
+    Returns true if an item was removed, false if the queue was empty.
+*/
+/**************************************************************************/
+template <typename T>
+bool SPSCQueue<T>::try_pop_front(T& value)
+{
+  //Nothing to remove.
+  if (empty())
+    return false;
+
+  unsigned head = head_.load(std::memory_order_relaxed);
+  T *item = reinterpret_cast<T *>(&slots_[head & mask_]);
+
+  //Move the item out and destroy it, then give the slot back.
+  value = static_cast<T&&>(*item);
+  item->~T();
+  head_.store(head + 1, std::memory_order_release);
+
+  return true;
+}
+
+/**************************************************************************/
+/*!
+  \brief
+     Checks the value of the first item in the queue.
+
+  \return
+    Returns the value of the first item in the queue.
+*/
+/**************************************************************************/
+template <typename T>
+T SPSCQueue<T>::front() const
+{
+  unsigned head = head_.load(std::memory_order_relaxed);
+
+  return *reinterpret_cast<const T *>(&slots_[head & mask_]);
+}
+
+/**************************************************************************/
+/*!
+  \brief
+     Checks whether the queue is empty or not. The consumer only reads
+     the producer's position when its cached copy says the ring is empty.
+
+  \return
+    Returns true if the queue is empty, and false if it is not.
+*/
+/**************************************************************************/
+template <typename T>
+bool SPSCQueue<T>::empty() const
+{
+  unsigned head = head_.load(std::memory_order_relaxed);
+
+  //Refresh the producer's position only when it looks empty.
+  if (head == cached_tail_)
+    cached_tail_ = tail_.load(std::memory_order_acquire);
+
+  return head == cached_tail_;
+}
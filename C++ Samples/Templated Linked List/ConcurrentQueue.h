@@ -0,0 +1,203 @@
+/*****************************************************************************/
+/*!
+\file   ConcurrentQueue.h
+\author Rohit Saini
+\par    email: rohitsaini429@gmail.com
+
+\brief
+    This file contains the definition of two lock-free queues with the
+    same push_back / pop_front / front / empty interface as the templated
+    Linked List, for handing work between threads without a mutex.
+
+    MPSCQueue is a Vyukov style linked queue: any number of threads may
+    push_back, and one consumer thread pops. Its nodes are recycled through
+    a lock-free free list instead of the heap. It grows on demand up to a
+    hard cap of nodes given to the constructor (16,777,216 by default),
+    push_back throws std::bad_alloc once every node is in use.
+
+    SPSCQueue is a bounded ring buffer for the case where there is exactly
+    one producer thread and one consumer thread.
+*/
+/*****************************************************************************/
+#ifndef CONCURRENTQUEUE_H
+#define CONCURRENTQUEUE_H
+
+#include <atomic>      /* atomic */
+#include <new>         /* bad_alloc, placement new */
+#include <stdexcept>   /* length_error */
+#include <type_traits> /* aligned_storage */
+
+//! size of a cache line, hot members are kept on separate lines
+#define QUEUE_CACHE_LINE 64
+
+//! Multi-producer single-consumer lock-free queue
+template <typename T>
+class MPSCQueue
+{
+  public:
+
+    //! default cap on the number of nodes
+    static const unsigned DEFAULT_MAX_NODES = 16777216;
+
+    //! Constructor, max_nodes is rounded up to whole chunks of CHUNK_SIZE
+    //! nodes, and one node is always kept as the stub
+    explicit MPSCQueue(unsigned max_nodes = DEFAULT_MAX_NODES);
+
+    //! Destructor, no other thread may use the queue anymore
+    ~MPSCQueue();
+
+    //! adds the item to the end of the queue (any thread)
+    void push_back(const T& value);
+
+    //! removes the first item in the queue (consumer thread only)
+    void pop_front();
+
+    //! moves the first item into value and removes it, false if empty
+    //! (consumer thread only)
+    bool try_pop_front(T& value);
+
+    //! retrieves the first item in the queue (consumer thread only)
+    T front() const;
+
+    //! true if empty, else false (consumer thread only)
+    bool empty() const;
+
+  private:
+
+    //! Used to build the linked queue
+    struct Node
+    {
+      //! pointer to the next Node in the queue
+      std::atomic<Node *> next;
+
+      //! index of the next Node on the free list
+      std::atomic<unsigned> free_next;
+
+      //! index of this Node in the node table, starting at 1
+      unsigned index;
+
+      //! storage for the data, only constructed while queued
+      typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+
+      //! the actual data in the node
+      T &data() { return *reinterpret_cast<T *>(&storage); }
+      const T &data() const { return *reinterpret_cast<const T *>(&storage); }
+    };
+
+    //! number of Nodes in each chunk of the node table
+    static const unsigned CHUNK_SIZE = 4096;
+
+    //! number of chunk pointers in each page of the chunk directory
+    static const unsigned PAGE_CHUNKS = 64;
+
+    //! A page of the chunk directory
+    struct ChunkPage
+    {
+      //! chunks of nodes, allocated the first time they are needed
+      std::atomic<Node *> chunks[PAGE_CHUNKS];
+    };
+
+    //! Gets a node from the free list, or a never used one
+    Node *acquire_node();
+
+    //! Puts a node on the free list
+    void release_node(Node *node);
+
+    //! Gets the node with the given index
+    Node *node_at(unsigned index) const;
+
+    //! Gets the directory entry of a chunk, allocating its page if needed
+    std::atomic<Node *> &chunk_slot(unsigned chunk);
+
+    //! Disable copying, nodes are shared with other threads
+    MPSCQueue(const MPSCQueue &);
+    MPSCQueue &operator=(const MPSCQueue &);
+
+    //! last node, swapped by the producers
+    alignas(QUEUE_CACHE_LINE) std::atomic<Node *> tail_;
+
+    //! node before the first item, only touched by the consumer
+    alignas(QUEUE_CACHE_LINE) Node *head_;
+
+    //! top of the free list, node index in the low half and an ABA tag
+    //! in the high half
+    alignas(QUEUE_CACHE_LINE) std::atomic<unsigned long long> free_;
+
+    //! number of node indices handed out so far
+    alignas(QUEUE_CACHE_LINE) std::atomic<unsigned> used_;
+
+    //! pages of the chunk directory, each allocated the first time it is
+    //! needed so an empty queue stays small
+    std::atomic<ChunkPage *> *pages_;
+
+    //! number of entries in pages_
+    unsigned page_count_;
+
+    //! number of chunks the node cap allows
+    unsigned max_chunks_;
+};
+
+//! Single-producer single-consumer bounded lock-free queue
+template <typename T>
+class SPSCQueue
+{
+  public:
+
+    //! largest capacity, positions wrap with a mask
+    static const unsigned MAX_CAPACITY = 1u << 31;
+
+    //! Constructor, capacity is rounded up to a power of 2, throws
+    //! std::length_error above MAX_CAPACITY
+    explicit SPSCQueue(unsigned capacity);
+
+    //! Destructor, no other thread may use the queue anymore
+    ~SPSCQueue();
+
+    //! adds the item to the end of the queue, false if the queue is full
+    //! (producer thread only)
+    bool push_back(const T& value);
+
+    //! removes the first item in the queue (consumer thread only)
+    void pop_front();
+
+    //! moves the first item into value and removes it, false if empty
+    //! (consumer thread only)
+    bool try_pop_front(T& value);
+
+    //! retrieves the first item in the queue (consumer thread only)
+    T front() const;
+
+    //! true if empty, else false (consumer thread only)
+    bool empty() const;
+
+  private:
+
+    //! Storage for one item
+    typedef typename std::aligned_storage<sizeof(T), alignof(T)>::type Slot;
+
+    //! Disable copying, the ring is shared with another thread
+    SPSCQueue(const SPSCQueue &);
+    SPSCQueue &operator=(const SPSCQueue &);
+
+    //! ring of items
+    Slot *slots_;
+
+    //! capacity - 1, used to wrap the positions
+    unsigned mask_;
+
+    //! next position to write, owned by the producer
+    alignas(QUEUE_CACHE_LINE) std::atomic<unsigned> tail_;
+
+    //! producer's last known value of head_
+    unsigned cached_head_;
+
+    //! next position to read, owned by the consumer
+    alignas(QUEUE_CACHE_LINE) std::atomic<unsigned> head_;
+
+    //! consumer's last known value of tail_
+    mutable unsigned cached_tail_;
+};
+
+#include "ConcurrentQueue.cpp"
+
+#endif
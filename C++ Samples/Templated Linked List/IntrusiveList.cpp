@@ -0,0 +1,285 @@
+/*****************************************************************************/
+/*!
+\file   IntrusiveList.cpp
+\author Rohit Saini
+\par    email: rohitsaini429@gmail.com
+\brief
+    This file contains the implementation of the following functions for
+    the intrusive Linked List.
+
+    Functions include:
+
+      + IntrusiveList
+      + ~IntrusiveList
+      + push_front
+      + push_back
+      + pop_front
+      + erase
+      + front
+      + size
+      + empty
+      + clear
+      + begin
+      + end
+      + hook_offset
+      + owner
+      + link
+*/
+/*****************************************************************************/
+
+/**************************************************************************/
+/*!
+  \brief
+    Initializes an empty list. The sentinel hook points at itself, so the
+    links never have to be checked for NULL.
+*/
+/**************************************************************************/
+template <typename T, ListHook T::*Hook>
+IntrusiveList<T, Hook>::IntrusiveList() : size_(0)
+{
+  root_.next = &root_;
+  root_.prev = &root_;
+}
+
+/**************************************************************************/
+/*!
+  \brief
+    Unlinks every item so that they can be put on another list.
+*/
+/**************************************************************************/
+template <typename T, ListHook T::*Hook>
+IntrusiveList<T, Hook>::~IntrusiveList()
+{
+  clear();
+}
+
+/**************************************************************************/
+/*!
+  \brief
+    Links an item at the front of the list. Nothing is allocated.
+
+  \param item
+    The item to link, it must not be on another list with this hook.
+*/
+/**************************************************************************/
+template <typename T, ListHook T::*Hook>
+void IntrusiveList<T, Hook>::push_front(T &item)
+{
+  //Link between the sentinel and the current first hook.
+  assert(!(item.*Hook).linked());
+  link(&(item.*Hook), &root_, root_.next);
+  size_++;
+}
+
+/**************************************************************************/
+/*!
+  \brief
+    Links an item at the end of the list. Nothing is allocated.
+
+  \param item
+    The item to link, it must not be on another list with this hook.
+*/
+/**************************************************************************/
+template <typename T, ListHook T::*Hook>
+void IntrusiveList<T, Hook>::push_back(T &item)
+{
+  //Link between the current last hook and the sentinel.
+  assert(!(item.*Hook).linked());
+  link(&(item.*Hook), root_.prev, &root_);
+  size_++;
+}
+
+/**************************************************************************/
+/*!
+  \brief
+     Unlinks the very first item in the list (if it exists). If the list
+     is empty, nothing is done.
+*/
+/**************************************************************************/
+template <typename T, ListHook T::*Hook>
+void IntrusiveList<T, Hook>::pop_front()
+{
+  //Only remove if the first item exists.
+  if (!empty())
+    erase(*owner(root_.next));
+}
+
+/**************************************************************************/
+/*!
+  \brief
+     Unlinks an item from the list in O(1), using its own links.
+
+  \param item
+    The item to unlink, it must be on this list.
+*/
+/**************************************************************************/
+template <typename T, ListHook T::*Hook>
+void IntrusiveList<T, Hook>::erase(T &item)
+{
+  ListHook *hook = &(item.*Hook);
+
+  //Join the neighbours of the hook.
+  hook->prev->next = hook->next;
+  hook->next->prev = hook->prev;
+
+  //Mark the hook as unlinked.
+  hook->next = 0;
+  hook->prev = 0;
+
+  size_--;
+}
+
+/**************************************************************************/
+/*!
+  \brief
+     Gets the first item in the list.
+
+  \return
+    Returns a reference to the first item, the list must not be empty.
+*/
+/**************************************************************************/
+template <typename T, ListHook T::*Hook>
+T &IntrusiveList<T, Hook>::front() const
+{
+  return *owner(root_.next);
+}
+
+/**************************************************************************/
+/*!
+  \brief
+     Checks the number of items that are currently in the list.
+
+  \return
+    Returns the number of items in the list.
+*/
+/**************************************************************************/
+template <typename T, ListHook T::*Hook>
+int IntrusiveList<T, Hook>::size() const
+{
+  return size_;
+}
+
+/**************************************************************************/
+/*!
+  \brief
+     Checks whether the list is empty or not.
+
+  \return
+    Returns true if the list is empty, and false if it is not.
+*/
+/**************************************************************************/
+template <typename T, ListHook T::*Hook>
+bool IntrusiveList<T, Hook>::empty() const
+{
+  return size_ == 0;
+}
+
+/**************************************************************************/
+/*!
+  \brief
+     Unlinks every item in the list. The items themselves are untouched.
+*/
+/**************************************************************************/
+template <typename T, ListHook T::*Hook>
+void IntrusiveList<T, Hook>::clear()
+{
+  //While the list is not empty, unlink the first item
+  while (!empty())
+    pop_front();
+}
+
+/**************************************************************************/
+/*!
+  \brief
+    Gets an iterator to the first item in the list.
+
+  \return
+    Returns an iterator to the first item, or end() if the list is empty.
+*/
+/**************************************************************************/
+template <typename T, ListHook T::*Hook>
+typename IntrusiveList<T, Hook>::iterator IntrusiveList<T, Hook>::begin() const
+{
+  return iterator(root_.next);
+}
+
+/**************************************************************************/
+/*!
+  \brief
+    Gets an iterator one past the last item in the list.
+
+  \return
+    Returns the end iterator, which must not be dereferenced.
+*/
+/**************************************************************************/
+template <typename T, ListHook T::*Hook>
+typename IntrusiveList<T, Hook>::iterator IntrusiveList<T, Hook>::end() const
+{
+  return iterator(&root_);
+}
+
+/**************************************************************************/
+/*!
+  \brief
+    Gets the offset of the Hook member inside T, the way offsetof does,
+    from the address of the member of a T laid over static storage that is
+    sized and aligned for one. Nothing is read or constructed there, and
+    the storage is zero initialized so no static guard is needed.
+
+  \return
+    Returns the number of bytes from the start of a T to its hook.
+*/
+/**************************************************************************/
+template <typename T, ListHook T::*Hook>
+std::ptrdiff_t IntrusiveList<T, Hook>::hook_offset()
+{
+  //Real storage for one T, only its addresses are ever used.
+  alignas(T) static unsigned char storage[sizeof(T)];
+  T *shape = std::launder(reinterpret_cast<T *>(storage));
+
+  return reinterpret_cast<char *>(&(shape->*Hook)) -
+         reinterpret_cast<char *>(shape);
+}
+
+/**************************************************************************/
+/*!
+  \brief
+    Gets the item that contains a hook, by stepping back from the hook by
+    the offset of the hook member inside T.
+
+  \param hook
+    A hook that is the Hook member of some T.
+
+  \return
+    Returns a pointer to the item that contains the hook.
+*/
+/**************************************************************************/
+template <typename T, ListHook T::*Hook>
+T *IntrusiveList<T, Hook>::owner(ListHook *hook)
+{
+  return reinterpret_cast<T *>(reinterpret_cast<char *>(hook) - hook_offset());
+}
+
+/**************************************************************************/
+/*!
+  \brief
+    Links a hook between two neighbouring hooks.
+
+  \param hook
+    The hook to link.
+
+  \param prev
+    The hook that will come before it.
+
+  \param next
+    The hook that will come after it.
+*/
+/**************************************************************************/
+template <typename T, ListHook T::*Hook>
+void IntrusiveList<T, Hook>::link(ListHook *hook, ListHook *prev, ListHook *next)
+{
+  hook->prev = prev;
+  hook->next = next;
+  prev->next = hook;
+  next->prev = hook;
+}
@@ -0,0 +1,155 @@
+/*****************************************************************************/
+/*!
+\file   IntrusiveList.h
+\author Rohit Saini
+\par    email: rohitsaini429@gmail.com
+
+\brief
+    This file contains the definition of an intrusive version of the
+    templated Linked List. Instead of wrapping each item in a Node, the
+    items carry their own links in a ListHook member, so linking and
+    unlinking never allocate and an object can move from one list to
+    another without any heap traffic. The list does not own its items.
+
+    Usage:
+
+      struct Job
+      {
+        int id;
+        ListHook hook;
+      };
+
+      IntrusiveList<Job, &Job::hook> queue;
+      queue.push_back(job);
+*/
+/*****************************************************************************/
+#ifndef INTRUSIVELIST_H
+#define INTRUSIVELIST_H
+
+#include <cassert>     /* assert */
+#include <cstddef>     /* ptrdiff_t */
+#include <new>         /* launder */
+#include <iterator>    /* forward_iterator_tag */
+
+//! Links embedded in an item, an item can be on one list per hook
+struct ListHook
+{
+  //! Creates an unlinked hook
+  ListHook() : next(0), prev(0) {}
+
+  //! Copying an item does not put the copy on the item's lists
+  ListHook(const ListHook &) : next(0), prev(0) {}
+
+  //! Assigning an item keeps the lists the target is on
+  ListHook &operator=(const ListHook &) { return *this; }
+
+  //! true if the item is on a list
+  bool linked() const { return next != 0; }
+
+  //! pointer to the next hook
+  ListHook *next;
+
+  //! pointer to the previous hook
+  ListHook *prev;
+};
+
+//! The intrusive list class
+template <typename T, ListHook T::*Hook>
+class IntrusiveList
+{
+  public:
+
+    //! Forward iterator over the items of a list
+    class iterator
+    {
+      public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef T value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef T *pointer;
+        typedef T &reference;
+
+        //! Creates an iterator that points nowhere
+        iterator() : hook_(0) {}
+
+        //! Access the item the iterator points to
+        T &operator*() const { return *owner(hook_); }
+        T *operator->() const { return owner(hook_); }
+
+        //! Move to the next item
+        iterator &operator++() { hook_ = hook_->next; return *this; }
+        iterator operator++(int) { iterator old(*this); hook_ = hook_->next; return old; }
+
+        //! Iterators are equal when they point to the same hook
+        friend bool operator==(const iterator &a, const iterator &b) { return a.hook_ == b.hook_; }
+        friend bool operator!=(const iterator &a, const iterator &b) { return a.hook_ != b.hook_; }
+
+      private:
+        friend class IntrusiveList;
+
+        //! Only the list creates iterators to its hooks
+        explicit iterator(ListHook *hook) : hook_(hook) {}
+
+        //! the hook the iterator points to
+        ListHook *hook_;
+    };
+
+    //! Default constructor
+    IntrusiveList();
+
+    //! Destructor, unlinks the items but does not destroy them
+    ~IntrusiveList();
+
+    //! links the item at the front of the list
+    void push_front(T &item);
+    //! links the item at the end of the list
+    void push_back(T &item);
+    //! unlinks the first item in the list
+    void pop_front();
+
+    //! unlinks the item from anywhere in the list in O(1)
+    void erase(T &item);
+
+    //! retrieves the first item in the list
+    T &front() const;
+
+    //! returns the number of items in list
+    int size() const;
+
+    //! true if empty, else false
+    bool empty() const;
+
+    //! unlinks every item
+    void clear();
+
+    //! iterator to the first item
+    iterator begin() const;
+
+    //! iterator one past the last item
+    iterator end() const;
+
+  private:
+
+    //! Gets the offset of the hook member inside T
+    static std::ptrdiff_t hook_offset();
+
+    //! Gets the item that contains the hook
+    static T *owner(ListHook *hook);
+
+    //! Links a hook between two others
+    static void link(ListHook *hook, ListHook *prev, ListHook *next);
+
+    //! Disable copying, an item can only be on one list per hook
+    IntrusiveList(const IntrusiveList &);
+    IntrusiveList &operator=(const IntrusiveList &);
+
+    //! sentinel, its next is the first hook and its prev is the last
+    mutable ListHook root_;
+
+    //! number of items on the list
+    int size_;
+};
+
+#include "IntrusiveList.cpp"
+
+#endif
@@ -11,6 +11,8 @@
 
       + Node(value)
       + new_node(value)
+      + delete_node(node)
+      + append_block(first, count)
       + List
       + List(list) (copy constructor)
       + List(array, size)
@@ -18,6 +20,17 @@
       + operator+= (self-addition of lists)
       + operator+ (addition of lists)
       + operator[] (array subscripting of lists)
+      + begin
+      + end
+      + insert_after
+      + erase_after
+      + for_each
+      + enable_index
+      + disable_index
+      + sort
+      + parallel_sort
+      + merge
+      + unique
       + push_front
       + push_back
       + pop_front
@@ -30,23 +43,32 @@
 */
 /*****************************************************************************/
 
-//Assign the initial number of alive nodes
-template <typename T>
-int List<T>::Node::nodes_alive = 0;
+#ifndef LIST_NO_NODE_ACCOUNTING
+//Counter of the nodes alive, starts at 0
+template <typename T, typename Alloc, int InlineNodes>
+NodeCounter List<T, Alloc, InlineNodes>::Node::nodes_alive;
+#endif
 
 /**************************************************************************/
 /*!
   \brief
-    Gets the number of Nodes that are still alive in the given list.
+    Gets the number of Nodes that are still alive in all lists of this
+    type. The per thread shards of the counter are added together here,
+    so this is the only place that touches every shard.
 
   \return
-    Returns the number of alive nodes in the list.
+    Returns the number of alive nodes, or 0 if the accounting has been
+    compiled out with LIST_NO_NODE_ACCOUNTING.
 */
 /**************************************************************************/
-template <typename T>
-int List<T>::node_count(void)
+template <typename T, typename Alloc, int InlineNodes>
+int List<T, Alloc, InlineNodes>::node_count(void)
 {
-  return Node::nodes_alive;
+#ifndef LIST_NO_NODE_ACCOUNTING
+  return static_cast<int>(Node::nodes_alive.total());
+#else
+  return 0;
+#endif
 }
 
 /**************************************************************************/
@@ -59,11 +81,13 @@ int List<T>::node_count(void)
 
 */
 /**************************************************************************/
-template <typename T>
-List<T>::Node::Node(T value) : data(value)
+template <typename T, typename Alloc, int InlineNodes>
+List<T, Alloc, InlineNodes>::Node::Node(T value) : data(value)
 {
+#ifndef LIST_NO_NODE_ACCOUNTING
   //Count new number of nodes alive
-  nodes_alive++;
+  nodes_alive.add(1);
+#endif
 }
 
 /**************************************************************************/
@@ -72,11 +96,13 @@ List<T>::Node::Node(T value) : data(value)
     Destroys a node structure.
 */
 /**************************************************************************/
-template <typename T>
-List<T>::Node::~Node()
+template <typename T, typename Alloc, int InlineNodes>
+List<T, Alloc, InlineNodes>::Node::~Node()
 {
+#ifndef LIST_NO_NODE_ACCOUNTING
   //Decrease nodes alive since a node is being destroyed
-  nodes_alive--;
+  nodes_alive.add(-1);
+#endif
 }
 
 /**************************************************************************/
@@ -85,8 +111,8 @@ List<T>::Node::~Node()
     Initializes the variables of a newly created List.
 */
 /**************************************************************************/
-template <typename T>
-List<T>::List()
+template <typename T, typename Alloc, int InlineNodes>
+List<T, Alloc, InlineNodes>::List()
 {
   //Set the head and tail to NULL.
   head_ = NULL;
@@ -94,6 +120,9 @@ List<T>::List()
 
   //Initialize the size to 0.
   size_ = 0;
+
+  //The list starts without checkpoints.
+  index_ = NULL;
 }
 
 /**************************************************************************/
@@ -106,8 +135,8 @@ List<T>::List()
     The list to copy the contents of and initialize with.
 */
 /**************************************************************************/
-template <typename T>
-List<T>::List(const List& list)
+template <typename T, typename Alloc, int InlineNodes>
+List<T, Alloc, InlineNodes>::List(const List& list) : pool_(list.pool_.allocator())
 {
   //Set the head and tail to NULL.
   head_ = NULL;
@@ -116,19 +145,15 @@ List<T>::List(const List& list)
   //Initialize the size to 0.
   size_ = 0;
 
-  //Start at the list's header node.
-  Node* current = list.head_;
+  //The list starts without checkpoints.
+  index_ = NULL;
 
-  //Loop through the list's nodes.
-  while (current)
-  {
-    //Push the list's nodes onto this list.
-    push_back(current->data);
-
-    //Move to the next node.
-    current = current->next;
-  }
+  //Keep the indexed mode of the list being copied.
+  if (list.index_)
+    enable_index(list.index_->stride);
 
+  //Copy the list's items into one block of nodes.
+  append_block(list.begin(), list.size_);
 }
 
 /**************************************************************************/
@@ -144,8 +169,8 @@ List<T>::List(const List& list)
     The size of the array.
 */
 /**************************************************************************/
-template <typename T>
-List<T>::List(const T *array, int size)
+template <typename T, typename Alloc, int InlineNodes>
+List<T, Alloc, InlineNodes>::List(const T *array, int size)
 {
   //Set the head and tail to NULL.
   head_ = NULL;
@@ -154,9 +179,11 @@ List<T>::List(const T *array, int size)
   //Initialize the size to 0.
   size_ = 0;
 
-  //Loop through the array's elements and push them onto the List.
-  for (int i = 0; i < size; i++)
-    push_back(array[i]);
+  //The list starts without checkpoints.
+  index_ = NULL;
+
+  //Copy the array's elements into one block of nodes.
+  append_block(array, size);
 }
 
 /**************************************************************************/
@@ -165,32 +192,59 @@ List<T>::List(const T *array, int size)
     Frees all memory associated with the given List.
 */
 /**************************************************************************/
-template <typename T>
-List<T>::~List()
+template <typename T, typename Alloc, int InlineNodes>
+List<T, Alloc, InlineNodes>::~List()
 {
   //Delete all the nodes from the list.
   clear();
+
+  //Free the checkpoints.
+  disable_index();
 }
 
 /**************************************************************************/
 /*!
   \brief
-     Clears a list by deleting all of its nodes.
+     Clears a list by deleting all of its nodes. The nodes are destroyed
+     one by one, then every block of node storage is freed at once.
 */
 /**************************************************************************/
-template <typename T>
-void List<T>::clear()
+template <typename T, typename Alloc, int InlineNodes>
+void List<T, Alloc, InlineNodes>::clear()
 {
-  //While the list is not empty, remove the first element
-  while (!empty())
-    pop_front();
+  //Destroy every node.
+  Node* current = head_;
+  while (current)
+  {
+    Node* next = current->next;
+    current->~Node();
+    current = next;
+  }
+
+  //Set the head and tail to NULL and the size to 0.
+  head_ = NULL;
+  tail_ = NULL;
+  size_ = 0;
+
+  //An empty list has no checkpoints.
+  if (index_)
+  {
+    index_->checkpoints.clear();
+    index_->base = 0;
+    index_->dirty = false;
+  }
+
+  //Free the storage of all the nodes together.
+  pool_.release_all();
 }
 
 /**************************************************************************/
 /*!
   \brief
     Copies the contents of the given list into this class' list and
-    returns a self-reference.
+    returns a self-reference. The nodes already owned by this list are
+    reused by overwriting their data in place, so only the nodes that are
+    missing are allocated and any surplus nodes are freed.
 
   \param rhs
     The list to copy the contents of and initialize with.
@@ -200,31 +254,39 @@ void List<T>::clear()
     values.
 */
 /**************************************************************************/
-template <typename T>
-List<T>& List<T>::operator=(const List& rhs)
+template <typename T, typename Alloc, int InlineNodes>
+List<T, Alloc, InlineNodes>& List<T, Alloc, InlineNodes>::operator=(const List& rhs)
 {
   //Make sure there is no self assignment
   if (&rhs != this)
   {
-    //Set the head and tail to NULL.
-    head_ = NULL;
-    tail_ = NULL;
+    //Start at both lists' first items.
+    const_iterator source = rhs.begin();
+    iterator target = begin();
 
-    //Initialize the size to 0.
-    size_ = 0;
+    //The last item of this list that received a value.
+    iterator last = end();
 
-    //Start at the list's header node.
-    Node* current = rhs.head_;
-
-    //Loop through the list's nodes.
-    while (current)
+    //Overwrite the data of the existing nodes while both lists have nodes.
+    while (source != rhs.end() && target != end())
     {
-      //Push the list's nodes onto this list.
-      push_back(current->data);
+      *target = *source;
 
-      //Move to the next node.
-      current = current->next;
+      //Move both lists to the next item.
+      last = target++;
+      ++source;
     }
+
+    //If this list ran out of nodes, allocate only the missing ones.
+    if (source != rhs.end())
+      append_block(source, rhs.size_ - size_);
+
+    //If this list has more nodes than rhs, free the surplus ones.
+    if (rhs.empty())
+      clear();
+    else
+      while (size_ > rhs.size_)
+        erase_after(last);
   }
 
   //Return a reference to this class
@@ -243,21 +305,12 @@ List<T>& List<T>::operator=(const List& rhs)
     Returns a reference to this class' list after adding the new values.
 */
 /**************************************************************************/
-template <typename T>
-List<T>& List<T>::operator+=(const List& rhs)
+template <typename T, typename Alloc, int InlineNodes>
+List<T, Alloc, InlineNodes>& List<T, Alloc, InlineNodes>::operator+=(const List& rhs)
 {
-  //Start at the header node of the given list.
-  Node* current = rhs.head_;
-
-  //Loop while there is another node.
-  while (current)
-  {
-    //Push a node with the same value onto this class' list.
-    push_back(current->data);
-
-    //Move to the next node.
-    current = current->next;
-  }
+  //Copy the items of rhs into one block of nodes. Only the items rhs has
+  //now are copied, in case rhs is this list.
+  append_block(rhs.begin(), rhs.size_);
 
   //Return a self-reference.
   return *this;
@@ -276,24 +329,14 @@ List<T>& List<T>::operator+=(const List& rhs)
     Returns a new List containing both the lists values.
 */
 /**************************************************************************/
-template <typename T>
-List<T> List<T>::operator+(const List& rhs) const
+template <typename T, typename Alloc, int InlineNodes>
+List<T, Alloc, InlineNodes> List<T, Alloc, InlineNodes>::operator+(const List& rhs) const
 {
   //Create a new list starting with the LHS (this class' list).
-  List<T> newList(*this);
-
-  //Start at the new list's header node.
-  Node* current = rhs.head_;
+  List newList(*this);
 
-  //Loop while there is a node in the list.
-  while (current)
-  {
-    //Push that node's data onto the new list.
-    newList.push_back(current->data);
-
-    //Update the node
-    current = current->next;
-  }
+  //Append the items of the RHS to the new list.
+  newList += rhs;
 
   //Return the newly created list.
   return newList;
@@ -313,29 +356,15 @@ List<T> List<T>::operator+(const List& rhs) const
     the given index.
 */
 /**************************************************************************/
-template <typename T>
-const T& List<T>::operator[](int index) const
+template <typename T, typename Alloc, int InlineNodes>
+const T& List<T, Alloc, InlineNodes>::operator[](int index) const
 {
   //If the index is out of bounds, return the first node's value.
   if (index <= 0 || index > size() - 1)
     return head_->data;
 
-  //Start at the header node.
-  Node* toReturn = head_;
-
-  //Loop until you reach the specified index.
-  for (int i = 0; i <= index; i++)
-  {
-    //If the index is found, return the data variable of that node.
-    if (i == index)
-      return toReturn->data;
-
-    //Otherwise move to the next node.
-    toReturn = toReturn->next;
-  }
-
-  //If code reaches here, the index was never found, so return first value.
-  return head_->data;
+  //Walk to the node, starting from the nearest checkpoint if indexed.
+  return node_at(index)->data;
 }
 
 /**************************************************************************/
@@ -352,29 +381,804 @@ const T& List<T>::operator[](int index) const
     index.
 */
 /**************************************************************************/
-template <typename T>
-T& List<T>::operator[](int index)
+template <typename T, typename Alloc, int InlineNodes>
+T& List<T, Alloc, InlineNodes>::operator[](int index)
 {
   //If the index is out of bounds, return the first node's value.
   if (index <= 0 || index > size() - 1)
     return head_->data;
 
+  //Walk to the node, starting from the nearest checkpoint if indexed.
+  return node_at(index)->data;
+}
+
+/**************************************************************************/
+/*!
+  \brief
+    Gets an iterator to the first item in the list.
+
+  \return
+    Returns an iterator to the first item, or end() if the list is empty.
+*/
+/**************************************************************************/
+template <typename T, typename Alloc, int InlineNodes>
+typename List<T, Alloc, InlineNodes>::iterator List<T, Alloc, InlineNodes>::begin()
+{
+  return iterator(head_);
+}
+
+/**************************************************************************/
+/*!
+  \brief
+    Gets a const iterator to the first item in the list.
+
+  \return
+    Returns an iterator to the first item, or end() if the list is empty.
+*/
+/**************************************************************************/
+template <typename T, typename Alloc, int InlineNodes>
+typename List<T, Alloc, InlineNodes>::const_iterator List<T, Alloc, InlineNodes>::begin() const
+{
+  return const_iterator(head_);
+}
+
+/**************************************************************************/
+/*!
+  \brief
+    Gets an iterator one past the last item in the list.
+
+  \return
+    Returns the end iterator, which must not be dereferenced.
+*/
+/**************************************************************************/
+template <typename T, typename Alloc, int InlineNodes>
+typename List<T, Alloc, InlineNodes>::iterator List<T, Alloc, InlineNodes>::end()
+{
+  return iterator(0);
+}
+
+/**************************************************************************/
+/*!
+  \brief
+    Gets a const iterator one past the last item in the list.
+
+  \return
+    Returns the end iterator, which must not be dereferenced.
+*/
+/**************************************************************************/
+template <typename T, typename Alloc, int InlineNodes>
+typename List<T, Alloc, InlineNodes>::const_iterator List<T, Alloc, InlineNodes>::end() const
+{
+  return const_iterator(0);
+}
+
+/**************************************************************************/
+/*!
+  \brief
+    Adds a node right after the given position in O(1).
+
+  \param pos
+    Iterator to the item to insert after, must not be end().
+
+  \param value
+    The value of the new node.
+
+  \return
+    Returns an iterator to the newly inserted item.
+*/
+/**************************************************************************/
+template <typename T, typename Alloc, int InlineNodes>
+typename List<T, Alloc, InlineNodes>::iterator
+List<T, Alloc, InlineNodes>::insert_after(const_iterator pos, const T& value)
+{
+  //The list owns the node, so it is safe to modify it.
+  Node* before = const_cast<Node*>(pos.node_);
+
+  //Create the node and link it after pos.
+  Node* node = new_node(value);
+  node->next = before->next;
+  before->next = node;
+
+  //Inserting after the last node makes a new tail.
+  if (before == tail_)
+    tail_ = node;
+
+  //The positions after pos changed, rebuild the checkpoints when needed.
+  if (index_)
+    index_->dirty = true;
+
+  //Update the list size.
+  size_++;
+
+  return iterator(node);
+}
+
+/**************************************************************************/
+/*!
+  \brief
+    Removes the node right after the given position in O(1). If there is
+    no node after pos, nothing is done.
+
+  \param pos
+    Iterator to the item before the one to remove, must not be end().
+
+  \return
+    Returns an iterator to the item that followed the removed one.
+*/
+/**************************************************************************/
+template <typename T, typename Alloc, int InlineNodes>
+typename List<T, Alloc, InlineNodes>::iterator List<T, Alloc, InlineNodes>::erase_after(const_iterator pos)
+{
+  //The list owns the node, so it is safe to modify it.
+  Node* before = const_cast<Node*>(pos.node_);
+  Node* toDelete = before->next;
+
+  //Nothing to remove after the last node.
+  if (!toDelete)
+    return end();
+
+  //Unlink the node, removing the last node makes pos the new tail.
+  before->next = toDelete->next;
+  if (toDelete == tail_)
+    tail_ = before;
+
+  //The positions after pos changed, rebuild the checkpoints when needed.
+  if (index_)
+    index_->dirty = true;
+
+  //Return the node to the pool.
+  delete_node(toDelete);
+
+  //Update the size of the list.
+  size_--;
+
+  return iterator(before->next);
+}
+
+/**************************************************************************/
+/*!
+  \brief
+    Calls a function on every item in the list, from front to back.
+
+  \param fn
+    The function (or function object) to call with each item.
+
+  \return
+    Returns the function object after it has visited every item.
+*/
+/**************************************************************************/
+template <typename T, typename Alloc, int InlineNodes>
+template <typename Function>
+Function List<T, Alloc, InlineNodes>::for_each(Function fn)
+{
+  for (iterator it = begin(); it != end(); ++it)
+    fn(*it);
+
+  return fn;
+}
+
+/**************************************************************************/
+/*!
+  \brief
+    Calls a function on every item in a const list, from front to back.
+
+  \param fn
+    The function (or function object) to call with each item.
+
+  \return
+    Returns the function object after it has visited every item.
+*/
+/**************************************************************************/
+template <typename T, typename Alloc, int InlineNodes>
+template <typename Function>
+Function List<T, Alloc, InlineNodes>::for_each(Function fn) const
+{
+  for (const_iterator it = begin(); it != end(); ++it)
+    fn(*it);
+
+  return fn;
+}
+
+/**************************************************************************/
+/*!
+  \brief
+    Turns on the indexed mode. A checkpoint is kept for every stride-th
+    node, so operator[] jumps to the nearest checkpoint and walks at most
+    stride - 1 nodes from there. push_front, push_back and pop_front keep
+    the checkpoints up to date in O(1), operator+= and clear keep them up
+    to date as well, changes that move nodes rebuild them on the next
+    subscript.
+
+  \param stride
+    The number of nodes between two checkpoints, values below 1 are
+    treated as 1.
+*/
+/**************************************************************************/
+template <typename T, typename Alloc, int InlineNodes>
+void List<T, Alloc, InlineNodes>::enable_index(int stride)
+{
+  //Create the checkpoints the first time.
+  if (!index_)
+    index_ = new Index;
+
+  //Build the checkpoints for the new stride on the next subscript, an
+  //empty list has none to build.
+  index_->stride = stride < 1 ? 1 : stride;
+  index_->base = 0;
+  index_->checkpoints.clear();
+  index_->dirty = size_ != 0;
+}
+
+/**************************************************************************/
+/*!
+  \brief
+    Turns off the indexed mode and frees the checkpoints.
+*/
+/**************************************************************************/
+template <typename T, typename Alloc, int InlineNodes>
+void List<T, Alloc, InlineNodes>::disable_index()
+{
+  delete index_;
+  index_ = NULL;
+}
+
+/**************************************************************************/
+/*!
+  \brief
+    Finds the node at the given position. Without an index this walks from
+    the header node, otherwise it starts at the checkpoint at or before
+    the position.
+
+  \param index
+    The position of the node, must be within the list.
+
+  \return
+    Returns a pointer to the node at the position.
+*/
+/**************************************************************************/
+template <typename T, typename Alloc, int InlineNodes>
+typename List<T, Alloc, InlineNodes>::Node *List<T, Alloc, InlineNodes>::node_at(int index) const
+{
   //Start at the header node.
-  Node* toReturn = head_;
+  Node* node = head_;
+  int steps = index;
+
+  //Jump to the closest checkpoint at or before the index.
+  if (index_)
+  {
+    if (index_->dirty)
+      rebuild_index();
+
+    if (index >= index_->base)
+    {
+      node = index_->checkpoints[(index - index_->base) / index_->stride];
+      steps = (index - index_->base) % index_->stride;
+    }
+  }
+
+  //Walk the remaining nodes.
+  while (steps--)
+    node = node->next;
+
+  return node;
+}
+
+/**************************************************************************/
+/*!
+  \brief
+    Updates the checkpoints after a node was added to the front. Every
+    node moved back by one position, which is tracked by moving base
+    instead of touching the checkpoints, until the head itself falls on a
+    checkpoint position.
+*/
+/**************************************************************************/
+template <typename T, typename Alloc, int InlineNodes>
+void List<T, Alloc, InlineNodes>::index_push_front()
+{
+  //Nothing to do without an up to date index.
+  if (!index_ || index_->dirty)
+    return;
 
-  //Loop until you reach the specified index.
-  for (int i = 0; i <= index; i++)
+  //The first node is the first checkpoint.
+  if (size_ == 1)
   {
-    //If the index is found, return the data variable of that node.
-    if (i == index)
-      return toReturn->data;
+    index_->checkpoints.clear();
+    index_->checkpoints.push_back(head_);
+    index_->base = 0;
+    return;
+  }
 
-    //Otherwise move to the next node.
-    toReturn = toReturn->next;
+  //The head becomes a checkpoint once the first one is stride nodes away.
+  if (++index_->base == index_->stride)
+  {
+    index_->checkpoints.push_front(head_);
+    index_->base = 0;
   }
+}
 
-  //If code reaches here, the index was never found, so return first value.
-  return head_->data;
+/**************************************************************************/
+/*!
+  \brief
+    Updates the checkpoints after a node was added to the end.
+*/
+/**************************************************************************/
+template <typename T, typename Alloc, int InlineNodes>
+void List<T, Alloc, InlineNodes>::index_push_back()
+{
+  //Nothing to do without an up to date index.
+  if (!index_ || index_->dirty)
+    return;
+
+  //The first node is the first checkpoint.
+  if (size_ == 1)
+  {
+    index_->checkpoints.clear();
+    index_->checkpoints.push_back(head_);
+    index_->base = 0;
+    return;
+  }
+
+  //The tail is a checkpoint if it is a multiple of stride past base.
+  if ((size_ - 1 - index_->base) % index_->stride == 0)
+    index_->checkpoints.push_back(tail_);
+}
+
+/**************************************************************************/
+/*!
+  \brief
+    Updates the checkpoints before the first node is removed. Every node
+    moves forward by one position, and the head is dropped if it is a
+    checkpoint.
+*/
+/**************************************************************************/
+template <typename T, typename Alloc, int InlineNodes>
+void List<T, Alloc, InlineNodes>::index_pop_front()
+{
+  //Nothing to do without an up to date index.
+  if (!index_ || index_->dirty)
+    return;
+
+  //Removing the last node leaves no checkpoints.
+  if (size_ == 1)
+  {
+    index_->checkpoints.clear();
+    index_->base = 0;
+  }
+
+  //The head is the first checkpoint, so drop it.
+  else if (index_->base == 0)
+  {
+    index_->checkpoints.pop_front();
+    index_->base = index_->stride - 1;
+  }
+
+  //The first checkpoint moves one position closer to the front.
+  else
+    index_->base--;
+}
+
+/**************************************************************************/
+/*!
+  \brief
+    Rebuilds every checkpoint by walking the list once.
+*/
+/**************************************************************************/
+template <typename T, typename Alloc, int InlineNodes>
+void List<T, Alloc, InlineNodes>::rebuild_index() const
+{
+  index_->checkpoints.clear();
+  index_->base = 0;
+
+  //Record every stride-th node.
+  Node* node = head_;
+  for (int i = 0; node; i++, node = node->next)
+    if (i % index_->stride == 0)
+      index_->checkpoints.push_back(node);
+
+  index_->dirty = false;
+}
+
+/**************************************************************************/
+/*!
+  \brief
+    Sorts the list in ascending order using operator<.
+*/
+/**************************************************************************/
+template <typename T, typename Alloc, int InlineNodes>
+void List<T, Alloc, InlineNodes>::sort()
+{
+  sort(std::less<T>());
+}
+
+/**************************************************************************/
+/*!
+  \brief
+    Sorts the list with a bottom-up merge sort that only relinks nodes, so
+    no item is copied and nothing is allocated. The sort is stable.
+
+  \param comp
+    Returns true if its first argument goes before its second.
+*/
+/**************************************************************************/
+template <typename T, typename Alloc, int InlineNodes>
+template <typename Compare>
+void List<T, Alloc, InlineNodes>::sort(Compare comp)
+{
+  //A thread count would otherwise be taken for the comparison.
+  static_assert(!std::is_integral<Compare>::value,
+                "sort takes a comparison, use parallel_sort(threads) for threads");
+
+  parallel_sort(comp, 1);
+}
+
+/**************************************************************************/
+/*!
+  \brief
+    Sorts the list in ascending order using operator<, on several threads.
+
+  \param threads
+    The number of threads to sort with, 1 sorts on the calling thread.
+*/
+/**************************************************************************/
+template <typename T, typename Alloc, int InlineNodes>
+void List<T, Alloc, InlineNodes>::parallel_sort(unsigned threads)
+{
+  parallel_sort(std::less<T>(), threads);
+}
+
+/**************************************************************************/
+/*!
+  \brief
+    Sorts the list like sort(comp), with the list cut into one piece per
+    thread. Each piece is sorted on its own thread, and the sorted pieces
+    are merged on the calling thread. If a thread can not be started, the
+    pieces left over are sorted on the calling thread.
+
+  \param comp
+    Returns true if its first argument goes before its second.
+
+  \param threads
+    The number of threads to sort with, 1 sorts on the calling thread.
+*/
+/**************************************************************************/
+template <typename T, typename Alloc, int InlineNodes>
+template <typename Compare>
+void List<T, Alloc, InlineNodes>::parallel_sort(Compare comp, unsigned threads)
+{
+  //Nothing to sort.
+  if (size_ < 2)
+    return;
+
+  //Use at most one thread per item.
+  int pieceCount = threads > static_cast<unsigned>(size_) ? size_ : static_cast<int>(threads);
+
+  if (pieceCount <= 1)
+    head_ = sort_nodes(head_, comp);
+  else
+  {
+    //Cut the list into one piece per thread.
+    std::vector<Node *> pieces(pieceCount);
+    Node* current = head_;
+
+    for (int i = 0; i < pieceCount; i++)
+    {
+      pieces[i] = current;
+
+      //Every piece has size_ / pieceCount nodes, the first
+      //size_ % pieceCount pieces get one extra node.
+      int count = size_ / pieceCount + (i < size_ % pieceCount ? 1 : 0);
+      for (int j = 1; j < count; j++)
+        current = current->next;
+
+      Node* next = current->next;
+      current->next = 0;
+      current = next;
+    }
+
+    //Sort the pieces at the same time, the first on this thread. A thread
+    //that fails to start stops the loop, the threads already running are
+    //still joined below.
+    std::vector<std::thread> workers;
+    int started = 1;
+
+    try
+    {
+      workers.reserve(pieceCount - 1);
+      for (; started < pieceCount; started++)
+        workers.push_back(std::thread([&pieces, comp, started]()
+        {
+          pieces[started] = sort_nodes(pieces[started], comp);
+        }));
+    }
+    catch (...)
+    {
+    }
+
+    try
+    {
+      //Sort the pieces no thread took on this thread.
+      for (int i = started; i < pieceCount; i++)
+        pieces[i] = sort_nodes(pieces[i], comp);
+
+      pieces[0] = sort_nodes(pieces[0], comp);
+
+      //Merge the pieces in order as they finish, keeping the sort stable.
+      //A merged piece is folded into the first one.
+      for (int i = 1; i < pieceCount; i++)
+      {
+        if (i < started)
+          workers[i - 1].join();
+        pieces[0] = merge_nodes(pieces[0], pieces[i], comp);
+        pieces[i] = 0;
+      }
+    }
+    catch (...)
+    {
+      //Wait for the threads still running, then chain the pieces back
+      //together so the list keeps all of its nodes.
+      for (size_t i = 0; i < workers.size(); i++)
+        if (workers[i].joinable())
+          workers[i].join();
+
+      Node* last = pieces[0];
+      for (int i = 1; i < pieceCount; i++)
+      {
+        if (!pieces[i])
+          continue;
+        while (last->next)
+          last = last->next;
+        last->next = pieces[i];
+      }
+
+      head_ = pieces[0];
+      relink_tail();
+      throw;
+    }
+
+    head_ = pieces[0];
+  }
+
+  //The nodes moved, so find the tail and rebuild the checkpoints.
+  relink_tail();
+}
+
+/**************************************************************************/
+/*!
+  \brief
+    Merges another list sorted with operator< into this one.
+
+  \param other
+    The list to take the nodes from, it is left empty.
+*/
+/**************************************************************************/
+template <typename T, typename Alloc, int InlineNodes>
+void List<T, Alloc, InlineNodes>::merge(List &&other)
+{
+  merge(static_cast<List &&>(other), std::less<T>());
+}
+
+/**************************************************************************/
+/*!
+  \brief
+    Merges another sorted list into this sorted list by relinking its
+    nodes. The storage of the other list's nodes is handed over to this
+    list's pool, only the few nodes stored inside the other list object
+    are copied. On equal items, the ones from this list come first.
+
+  \param other
+    The list to take the nodes from, it is left empty.
+
+  \param comp
+    Returns true if its first argument goes before its second.
+*/
+/**************************************************************************/
+template <typename T, typename Alloc, int InlineNodes>
+template <typename Compare>
+void List<T, Alloc, InlineNodes>::merge(List &&other, Compare comp)
+{
+  //Nothing to merge.
+  if (&other == this || other.empty())
+    return;
+
+  //Nodes inside the other list object can not be handed over, so copy
+  //them into this list's pool first.
+  Node** link = &other.head_;
+  while (*link)
+  {
+    Node* node = *link;
+
+    if (other.pool_.is_inline(node))
+    {
+      Node* copy = new_node(node->data);
+      copy->next = node->next;
+      *link = copy;
+      other.delete_node(node);
+      node = copy;
+    }
+
+    link = &node->next;
+  }
+
+  //This list now owns the storage of the other list's nodes.
+  pool_.adopt(other.pool_);
+
+  //Relink the two chains into one.
+  head_ = merge_nodes(head_, other.head_, comp);
+  size_ += other.size_;
+
+  //The other list is left empty.
+  other.head_ = NULL;
+  other.tail_ = NULL;
+  other.size_ = 0;
+  if (other.index_)
+    other.index_->dirty = true;
+
+  //Find the tail and rebuild the checkpoints.
+  relink_tail();
+}
+
+/**************************************************************************/
+/*!
+  \brief
+    Removes every item that is equal (operator==) to the item before it.
+    On a sorted list this leaves only one of each value.
+*/
+/**************************************************************************/
+template <typename T, typename Alloc, int InlineNodes>
+void List<T, Alloc, InlineNodes>::unique()
+{
+  unique(std::equal_to<T>());
+}
+
+/**************************************************************************/
+/*!
+  \brief
+    Removes every item for which same(previous, item) is true, where
+    previous is the item kept before it.
+
+  \param same
+    Returns true if the second item is a duplicate of the first.
+*/
+/**************************************************************************/
+template <typename T, typename Alloc, int InlineNodes>
+template <typename BinaryPredicate>
+void List<T, Alloc, InlineNodes>::unique(BinaryPredicate same)
+{
+  //Start at the header node.
+  Node* current = head_;
+
+  //Remove the duplicates that follow each kept node.
+  while (current && current->next)
+  {
+    if (same(current->data, current->next->data))
+      erase_after(const_iterator(current));
+    else
+      current = current->next;
+  }
+}
+
+/**************************************************************************/
+/*!
+  \brief
+    Merges two sorted chains of nodes into one by relinking them. On equal
+    items, the ones from the first chain come first.
+
+  \param first
+    The first node of the first chain, or NULL.
+
+  \param second
+    The first node of the second chain, or NULL.
+
+  \param comp
+    Returns true if its first argument goes before its second.
+
+  \return
+    Returns the first node of the merged chain.
+*/
+/**************************************************************************/
+template <typename T, typename Alloc, int InlineNodes>
+template <typename Compare>
+typename List<T, Alloc, InlineNodes>::Node *
+List<T, Alloc, InlineNodes>::merge_nodes(Node *first, Node *second, Compare comp)
+{
+  Node* merged = 0;
+  Node** link = &merged;
+
+  //Take the smaller head of the two chains each time.
+  while (first && second)
+  {
+    if (comp(second->data, first->data))
+    {
+      *link = second;
+      second = second->next;
+    }
+    else
+    {
+      *link = first;
+      first = first->next;
+    }
+
+    link = &(*link)->next;
+  }
+
+  //Whatever is left is already sorted.
+  *link = first ? first : second;
+
+  return merged;
+}
+
+/**************************************************************************/
+/*!
+  \brief
+    Sorts a chain of nodes with a bottom-up merge sort. Sorted runs are
+    kept in bins where bin i holds a run of 2^i nodes. Each node is merged
+    up through the full bins like a binary counter, and then the bins are
+    merged together.
+
+  \param first
+    The first node of the chain.
+
+  \param comp
+    Returns true if its first argument goes before its second.
+
+  \return
+    Returns the first node of the sorted chain.
+*/
+/**************************************************************************/
+template <typename T, typename Alloc, int InlineNodes>
+template <typename Compare>
+typename List<T, Alloc, InlineNodes>::Node *
+List<T, Alloc, InlineNodes>::sort_nodes(Node *first, Compare comp)
+{
+  //Enough bins for any chain that fits in memory.
+  const int BINS = 64;
+  Node* bins[BINS] = {};
+
+  while (first)
+  {
+    //Take the next node off the chain as a run of 1.
+    Node* run = first;
+    first = first->next;
+    run->next = 0;
+
+    //Carry the run up through the full bins, older runs go first.
+    int i = 0;
+    for (; i < BINS - 1 && bins[i]; i++)
+    {
+      run = merge_nodes(bins[i], run, comp);
+      bins[i] = 0;
+    }
+
+    bins[i] = run;
+  }
+
+  //Merge the bins, the higher bins hold the older runs.
+  Node* sorted = 0;
+  for (int i = 0; i < BINS; i++)
+    if (bins[i])
+      sorted = merge_nodes(bins[i], sorted, comp);
+
+  return sorted;
+}
+
+/**************************************************************************/
+/*!
+  \brief
+    Finds the tail of the list after its nodes were relinked, and marks
+    the checkpoints for a rebuild.
+*/
+/**************************************************************************/
+template <typename T, typename Alloc, int InlineNodes>
+void List<T, Alloc, InlineNodes>::relink_tail()
+{
+  //Walk to the last node.
+  tail_ = head_;
+  while (tail_ && tail_->next)
+    tail_ = tail_->next;
+
+  //The positions changed, so rebuild the checkpoints when needed.
+  if (index_)
+    index_->dirty = true;
 }
 
 /**************************************************************************/
@@ -387,8 +1191,8 @@ T& List<T>::operator[](int index)
     The value of the new node to be added to the front of the list.
 */
 /**************************************************************************/
-template <typename T>
-void List<T>::push_front(const T& value)
+template <typename T, typename Alloc, int InlineNodes>
+void List<T, Alloc, InlineNodes>::push_front(const T& value)
 {
   //If there is no header node, create one.
   if (!head_)
@@ -399,9 +1203,11 @@ void List<T>::push_front(const T& value)
     //Update the tail node.
     tail_ = head_;
 
-    //Update the node count and list size.
+    //Update the list size.
     size_++;
-    Node::nodes_alive++;
+
+    //The new node is the only checkpoint.
+    index_push_front();
 
     //Return since a node has been added.
     return;
@@ -416,9 +1222,11 @@ void List<T>::push_front(const T& value)
   //Update the header node.
   head_ = newHead;
 
-  //Increment the node count and list size.
-  Node::nodes_alive++;
+  //Increment the list size.
   size_++;
+
+  //Every checkpoint moved back by one position.
+  index_push_front();
 }
 
 /**************************************************************************/
@@ -431,8 +1239,8 @@ void List<T>::push_front(const T& value)
     The value of the new node to be added to the end of the list.
 */
 /**************************************************************************/
-template <typename T>
-void List<T>::push_back(const T& value)
+template <typename T, typename Alloc, int InlineNodes>
+void List<T, Alloc, InlineNodes>::push_back(const T& value)
 {
   //If there is no header node, create one.
   if (!head_)
@@ -443,9 +1251,11 @@ void List<T>::push_back(const T& value)
     //Update the tail node.
     tail_ = head_;
 
-    //Increment the node count and list size.
+    //Increment the list size.
     size_++;
-    Node::nodes_alive++;
+
+    //The new node is the only checkpoint.
+    index_push_back();
 
     //Return since the node has been added already.
     return;
@@ -457,9 +1267,11 @@ void List<T>::push_back(const T& value)
   //Update the tail pointer.
   tail_ = tail_->next;
 
-  //Increment the node count and list size.
+  //Increment the list size.
   size_++;
-  Node::nodes_alive++;
+
+  //The new tail may land on a checkpoint position.
+  index_push_back();
 }
 
 /**************************************************************************/
@@ -469,24 +1281,26 @@ void List<T>::push_back(const T& value)
      node does not exist, nothing is done.
 */
 /**************************************************************************/
-template <typename T>
-void List<T>::pop_front()
+template <typename T, typename Alloc, int InlineNodes>
+void List<T, Alloc, InlineNodes>::pop_front()
 {
 
   //Only remove if the first node exists.
   if (head_)
   {
+    //Every checkpoint moves forward by one position.
+    index_pop_front();
+
     //Store the node to delete.
     Node* toDelete = head_;
 
     //Preserve the link of the list by updating the header node.
     head_ = head_->next;
 
-    //Delete the old header node.
-    delete toDelete;
+    //Return the old header node to the pool.
+    delete_node(toDelete);
 
-    //Update the nodes alive and the size of the list.
-    Node::nodes_alive--;
+    //Update the size of the list.
     size_--;
   }
 
@@ -501,8 +1315,8 @@ void List<T>::pop_front()
     Returns the value of the first node in the list.
 */
 /**************************************************************************/
-template <typename T>
-T List<T>::front() const
+template <typename T, typename Alloc, int InlineNodes>
+T List<T, Alloc, InlineNodes>::front() const
 {
   //Return header node's T value (data).
   return head_->data;
@@ -517,8 +1331,8 @@ T List<T>::front() const
     Returns the number of items in the list.
 */
 /**************************************************************************/
-template <typename T>
-int List<T>::size() const
+template <typename T, typename Alloc, int InlineNodes>
+int List<T, Alloc, InlineNodes>::size() const
 {
   //Return the value of the number of nodes from the list class.
   return size_;
@@ -533,8 +1347,8 @@ int List<T>::size() const
     Returns true if the list is not empty, and false if the list is empty.
 */
 /**************************************************************************/
-template <typename T>
-bool List<T>::empty() const
+template <typename T, typename Alloc, int InlineNodes>
+bool List<T, Alloc, InlineNodes>::empty() const
 {
   //Return whether the list is empty or not by checking if the size is 0.
   return (size_ == 0);
@@ -544,7 +1358,8 @@ bool List<T>::empty() const
 /*!
   \brief
     Creates a node and returns it to the calling code. Initializes the
-    data and next variables.
+    data and next variables. The storage comes from the list's node pool
+    instead of a separate heap allocation.
 
   \param data
     The value to store in the new node's data variable.
@@ -553,15 +1368,121 @@ bool List<T>::empty() const
     Returns a pointer to the newly created node.
 */
 /**************************************************************************/
-template <typename T>
-typename List<T>::Node *List<T>::new_node(const T& data) const
+template <typename T, typename Alloc, int InlineNodes>
+typename List<T, Alloc, InlineNodes>::Node *List<T, Alloc, InlineNodes>::new_node(const T& data)
 {
-  Node *node = new Node(data); // create the node
-  node->next = 0;              // no next pointer yet
+  void *storage = pool_.acquire(); // get storage from the pool
+  Node *node;
+
+  try
+  {
+    node = new (storage) Node(data); // create the node
+  }
+  catch (...)
+  {
+    pool_.release(storage);          // give the storage back on failure
+    throw;
+  }
+
+  node->next = 0;                    // no next pointer yet
 
   return node;
 }
 
+/**************************************************************************/
+/*!
+  \brief
+    Destroys a node and returns its storage to the list's node pool.
+
+  \param node
+    The node to destroy.
+*/
+/**************************************************************************/
+template <typename T, typename Alloc, int InlineNodes>
+void List<T, Alloc, InlineNodes>::delete_node(Node *node)
+{
+  node->~Node();        // destroy the node
+  pool_.release(node);  // keep the storage for the next node
+}
+
+/**************************************************************************/
+/*!
+  \brief
+    Appends count items to the end of the list using a single block of
+    contiguous nodes from the pool, so the copy costs at most one
+    allocation and the new nodes are laid out in list order.
+
+  \param first
+    Iterator (or pointer) to the first item to copy.
+
+  \param count
+    The number of items to copy.
+*/
+/**************************************************************************/
+template <typename T, typename Alloc, int InlineNodes>
+template <typename InputIt>
+void List<T, Alloc, InlineNodes>::append_block(InputIt first, int count)
+{
+  //Nothing to append.
+  if (count <= 0)
+    return;
+
+  //Get storage for all of the nodes at once.
+  Node *block = static_cast<Node *>(pool_.acquire_block(count));
+  int built = 0;
+
+  try
+  {
+    //Construct the nodes in order, each linking to the next one.
+    for (; built < count; built++, ++first)
+    {
+      new (block + built) Node(*first);
+      block[built].next = block + built + 1;
+    }
+  }
+  catch (...)
+  {
+    //Destroy what was built and give all of the storage back.
+    for (int i = 0; i < count; i++)
+    {
+      if (i < built)
+        block[i].~Node();
+      pool_.release(block + i);
+    }
+    throw;
+  }
+
+  //The last new node ends the list.
+  block[count - 1].next = 0;
+
+  //Attach the block after the tail, or make it the whole list.
+  if (head_)
+    tail_->next = block;
+  else
+    head_ = block;
+
+  tail_ = block + count - 1;
+
+  //Extend the checkpoints over the new nodes, the ones before them keep
+  //their positions.
+  if (index_ && !index_->dirty)
+  {
+    //An empty list has its first checkpoint at the first new node.
+    if (size_ == 0)
+    {
+      index_->checkpoints.clear();
+      index_->base = 0;
+    }
+
+    //Every stride-th position past base is a checkpoint.
+    int first_checkpoint = (index_->stride - (size_ - index_->base) % index_->stride) % index_->stride;
+    for (int i = first_checkpoint; i < count; i += index_->stride)
+      index_->checkpoints.push_back(block + i);
+  }
+
+  size_ += count;
+}
+
 #include <iomanip> //ostream, setw, endl
 
 /*!**********************************************************************
@@ -576,19 +1497,13 @@ typename List<T>::Node *List<T>::new_node(const T& data) const
   \return
     The ouput stream (ref) that was passed in (for chaining)
 ************************************************************************/
-template <typename T>
-std::ostream &CS170::operator<<(std::ostream & os, const CS170::List<T> &list)
+template <typename T, typename Alloc, int InlineNodes>
+std::ostream &operator<<(std::ostream & os, const List<T, Alloc, InlineNodes> &list)
 {
-  //Start at the beginning
-  typename CS170::List<T>::Node *pnode = list.head_;
-
-  //Print each item
-  while (pnode != 0)
-  {
-    //Keep consistent spacing
-    os << std::setw(4) << pnode->data;
-    pnode = pnode->next;
-  }
+  //Print each item, keeping consistent spacing
+  typename List<T, Alloc, InlineNodes>::const_iterator it;
+  for (it = list.begin(); it != list.end(); ++it)
+    os << std::setw(4) << *it;
 
   //Print a new line for readability
   os << std::endl;
@@ -12,21 +12,117 @@
 #ifndef LIST_H
 #define LIST_H
 
-#include <iostream> /* ostream, endl */
-
-//! Declaration of class List
-template <typename T> class List;
+#include <cstddef>    /* ptrdiff_t */
+#include <deque>      /* deque */
+#include <functional> /* less, equal_to */
+#include <iostream>   /* ostream, endl */
+#include <iterator>   /* forward_iterator_tag */
+#include <memory>     /* allocator */
+#include <new>        /* placement new */
+#include <thread>     /* thread */
+#include <type_traits> /* is_integral */
+#include <vector>     /* vector */
+
+#include "NodeCounter.h"
+#include "NodePool.h"
+
+//! Declaration of class List, nodes are allocated from a pool that gets
+//! its slabs from Alloc, the first InlineNodes nodes live inside the List
+template <typename T, typename Alloc = std::allocator<T>, int InlineNodes = 8>
+class List;
 
 //! Definiton of output operator function
-template <typename T>
-std::ostream & operator<<(std::ostream & os, const List<T> &list);
+template <typename T, typename Alloc, int InlineNodes>
+std::ostream & operator<<(std::ostream & os, const List<T, Alloc, InlineNodes> &list);
 
 //! The list class
-template <typename T>
+template <typename T, typename Alloc, int InlineNodes>
 class List
 {
+  private:
+
+    //! Used to build the linked list (defined below)
+    struct Node;
+
   public:
 
+    //! Type of the items, so that std algorithms can use the list
+    typedef T value_type;
+
+    //! Forward iterator over the items of a list
+    class iterator
+    {
+      public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef T value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef T *pointer;
+        typedef T &reference;
+
+        //! Creates an iterator that points nowhere
+        iterator() : node_(0) {}
+
+        //! Access the item the iterator points to
+        T &operator*() const { return node_->data; }
+        T *operator->() const { return &node_->data; }
+
+        //! Move to the next item
+        iterator &operator++() { node_ = node_->next; return *this; }
+        iterator operator++(int) { iterator old(*this); node_ = node_->next; return old; }
+
+        //! Iterators are equal when they point to the same node
+        friend bool operator==(const iterator &a, const iterator &b) { return a.node_ == b.node_; }
+        friend bool operator!=(const iterator &a, const iterator &b) { return a.node_ != b.node_; }
+
+      private:
+        friend class List;
+        friend class const_iterator;
+
+        //! Only the list creates iterators to its nodes
+        explicit iterator(Node *node) : node_(node) {}
+
+        //! the node the iterator points to
+        Node *node_;
+    };
+
+    //! Forward iterator over the items of a const list
+    class const_iterator
+    {
+      public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef T value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef const T *pointer;
+        typedef const T &reference;
+
+        //! Creates an iterator that points nowhere
+        const_iterator() : node_(0) {}
+
+        //! Any iterator can be used where a const_iterator is expected
+        const_iterator(const iterator &it) : node_(it.node_) {}
+
+        //! Access the item the iterator points to
+        const T &operator*() const { return node_->data; }
+        const T *operator->() const { return &node_->data; }
+
+        //! Move to the next item
+        const_iterator &operator++() { node_ = node_->next; return *this; }
+        const_iterator operator++(int) { const_iterator old(*this); node_ = node_->next; return old; }
+
+        //! Iterators are equal when they point to the same node
+        friend bool operator==(const const_iterator &a, const const_iterator &b) { return a.node_ == b.node_; }
+        friend bool operator!=(const const_iterator &a, const const_iterator &b) { return a.node_ != b.node_; }
+
+      private:
+        friend class List;
+
+        //! Only the list creates iterators to its nodes
+        explicit const_iterator(const Node *node) : node_(node) {}
+
+        //! the node the iterator points to
+        const Node *node_;
+    };
+
     //! Default constructor
     List();
 
@@ -73,6 +169,56 @@ class List
     //! Overloaded subscript operator (set)
     T& operator[](int index);
 
+    //! iterator to the first item
+    iterator begin();
+    const_iterator begin() const;
+
+    //! iterator one past the last item
+    iterator end();
+    const_iterator end() const;
+
+    //! adds an item after the one at pos, returns an iterator to it
+    iterator insert_after(const_iterator pos, const T& value);
+
+    //! removes the item after the one at pos, returns the next iterator
+    iterator erase_after(const_iterator pos);
+
+    //! calls fn on every item in order, returns fn
+    template <typename Function>
+    Function for_each(Function fn);
+
+    //! calls fn on every item in order, returns fn
+    template <typename Function>
+    Function for_each(Function fn) const;
+
+    //! keeps a checkpoint every stride nodes so operator[] walks at most
+    //! stride - 1 nodes, off by default
+    void enable_index(int stride);
+
+    //! frees the checkpoints, operator[] walks from the head again
+    void disable_index();
+
+    //! stable merge sort that only relinks nodes
+    void sort();
+    template <typename Compare>
+    void sort(Compare comp);
+
+    //! the same sort with the list split into pieces that are sorted on
+    //! separate threads
+    void parallel_sort(unsigned threads);
+    template <typename Compare>
+    void parallel_sort(Compare comp, unsigned threads);
+
+    //! moves the nodes of another sorted list into this sorted list
+    void merge(List &&other);
+    template <typename Compare>
+    void merge(List &&other, Compare comp);
+
+    //! removes items equal to the item before them
+    void unique();
+    template <typename BinaryPredicate>
+    void unique(BinaryPredicate same);
+
     /*!**********************************************************************
       Outputs all of the data in a list to an output stream.
 
@@ -85,7 +231,7 @@ class List
       \return
         The ouput stream (ref) that was passed in (for chaining)
     ************************************************************************/
-    friend std::ostream& operator<< <T>(std::ostream & os, const List &list);
+    friend std::ostream& operator<< <T, Alloc, InlineNodes>(std::ostream & os, const List &list);
 
     //! Returns the number of Nodes that have been created
     static int node_count();
@@ -107,8 +253,10 @@ class List
       //! the actual data in the node
       T data;
 
-      //! number of Nodes created
-      static int nodes_alive;
+#ifndef LIST_NO_NODE_ACCOUNTING
+      //! number of Nodes alive, sharded per thread
+      static NodeCounter nodes_alive;
+#endif
     };
 
     //! pointer to the head of the list
@@ -120,8 +268,59 @@ class List
     //! number of items on the list
     int size_;
 
+    //! pool that all the nodes are allocated from
+    NodePool<Node, Alloc, InlineNodes> pool_;
+
+    //! Checkpoints for the indexed mode
+    struct Index
+    {
+      //! number of nodes between two checkpoints
+      int stride;
+
+      //! position of the first checkpoint, always less than stride
+      int base;
+
+      //! checkpoint j is the node at position base + j * stride
+      std::deque<Node *> checkpoints;
+
+      //! true when the checkpoints must be rebuilt before use
+      bool dirty;
+    };
+
+    //! checkpoints, NULL unless the indexed mode is on
+    Index *index_;
+
+    //! Finds the node at a valid position
+    Node *node_at(int index) const;
+
+    //! Keep the checkpoints in sync with push_front, push_back, pop_front
+    void index_push_front();
+    void index_push_back();
+    void index_pop_front();
+
+    //! Rebuilds the checkpoints by walking the whole list
+    void rebuild_index() const;
+
+    //! Merges two sorted chains of nodes into one by relinking
+    template <typename Compare>
+    static Node *merge_nodes(Node *first, Node *second, Compare comp);
+
+    //! Sorts a chain of nodes by relinking, returns the new first node
+    template <typename Compare>
+    static Node *sort_nodes(Node *first, Compare comp);
+
+    //! Finds the tail again after the nodes were relinked
+    void relink_tail();
+
     //! All nodes are created in this method
-    Node *new_node(const T& data) const;
+    Node *new_node(const T& data);
+
+    //! All nodes are destroyed in this method
+    void delete_node(Node *node);
+
+    //! Appends count items as one contiguous block of nodes
+    template <typename InputIt>
+    void append_block(InputIt first, int count);
 };
 
 #include "List.cpp"
@@ -0,0 +1,71 @@
+/*****************************************************************************/
+/*!
+\file   NodeCounter.h
+\author Rohit Saini
+\par    email: rohitsaini429@gmail.com
+
+\brief
+    This file contains a thread safe counter used for the node accounting
+    of the templated Linked List. Every thread adds to its own shard, and
+    each shard sits on its own cache line, so threads that create and
+    destroy nodes at the same time do not fight over one counter. The
+    shards are only added together when the count is read.
+
+    Defining LIST_NO_NODE_ACCOUNTING before including List.h compiles the
+    accounting out of the nodes entirely.
+*/
+/*****************************************************************************/
+#ifndef NODECOUNTER_H
+#define NODECOUNTER_H
+
+#include <atomic> /* atomic */
+
+//! Counter split into per thread shards. It has no constructor so that a
+//! static NodeCounter is zero initialized before any node can use it.
+class NodeCounter
+{
+  public:
+
+    //! Adds to the shard of the calling thread
+    void add(long delta)
+    {
+      shards_[shard_index()].count.fetch_add(delta, std::memory_order_relaxed);
+    }
+
+    //! Adds all of the shards together
+    long total() const
+    {
+      long sum = 0;
+
+      for (int i = 0; i < SHARDS; i++)
+        sum += shards_[i].count.load(std::memory_order_relaxed);
+
+      return sum;
+    }
+
+  private:
+
+    //! number of shards, threads beyond this share shards round robin
+    static const int SHARDS = 64;
+
+    //! One counter per cache line
+    struct alignas(64) Shard
+    {
+      std::atomic<long> count;
+    };
+
+    //! Gets the shard of the calling thread, picked once per thread
+    static int shard_index()
+    {
+      static std::atomic<unsigned> next_shard(0);
+      thread_local int index =
+        static_cast<int>(next_shard.fetch_add(1, std::memory_order_relaxed) % SHARDS);
+
+      return index;
+    }
+
+    //! the shards
+    Shard shards_[SHARDS];
+};
+
+#endif
@@ -0,0 +1,295 @@
+/*****************************************************************************/
+/*!
+\file   NodePool.cpp
+\author Rohit Saini
+\par    email: rohitsaini429@gmail.com
+\brief
+    This file contains the implementation of the following functions for
+    the pooled node allocator of the templated Linked List.
+
+    Functions include:
+
+      + NodePool(alloc)
+      + ~NodePool
+      + acquire
+      + acquire_block
+      + release
+      + release_all
+      + adopt
+      + allocator
+      + is_inline
+      + grow
+*/
+/*****************************************************************************/
+
+/**************************************************************************/
+/*!
+  \brief
+    Initializes an empty pool. The inline slots are handed out first, so
+    no memory is requested until more than InlineNodes nodes are needed.
+
+  \param alloc
+    The allocator that slabs will be requested from.
+*/
+/**************************************************************************/
+template <typename Node, typename Alloc, int InlineNodes>
+NodePool<Node, Alloc, InlineNodes>::NodePool(const Alloc &alloc)
+  : alloc_(alloc), slabs_(0), free_(0), capacity_(0)
+{
+  //Carve from the inline slots first.
+  cursor_ = inline_;
+  end_ = inline_ + InlineNodes;
+
+  //The header is stored in the first slot of each slab, so it must fit.
+  static_assert(sizeof(SlabHeader) <= sizeof(Slot),
+                "slab header does not fit in a node slot");
+}
+
+/**************************************************************************/
+/*!
+  \brief
+    Returns every slab owned by the pool to the allocator. All nodes must
+    have been destroyed already.
+*/
+/**************************************************************************/
+template <typename Node, typename Alloc, int InlineNodes>
+NodePool<Node, Alloc, InlineNodes>::~NodePool()
+{
+  release_all();
+}
+
+/**************************************************************************/
+/*!
+  \brief
+    Gets the storage for a single node. Released slots are reused first,
+    otherwise the next untouched slot of the newest slab is used, so
+    nodes that are requested one after another are adjacent in memory.
+
+  \return
+    Returns a pointer to uninitialized storage for one node.
+*/
+/**************************************************************************/
+template <typename Node, typename Alloc, int InlineNodes>
+void *NodePool<Node, Alloc, InlineNodes>::acquire()
+{
+  //Reuse a released slot if there is one.
+  if (free_)
+  {
+    Slot *slot = free_;
+    free_ = free_->next;
+
+    return slot;
+  }
+
+  //Allocate a new slab when the newest one is used up, each new slab is
+  //twice the size of the previous one up to MAX_SLAB slots.
+  if (cursor_ == end_)
+  {
+    int capacity = capacity_ ? capacity_ * 2 : FIRST_SLAB;
+    grow(capacity > MAX_SLAB ? MAX_SLAB : capacity);
+  }
+
+  //Carve the next slot out of the newest slab.
+  return cursor_++;
+}
+
+/**************************************************************************/
+/*!
+  \brief
+    Gets the storage for count nodes in one contiguous block. The rest of
+    the newest slab is used if it is big enough, otherwise one slab of
+    exactly count slots is allocated, so building a list of any size costs
+    at most one allocation. The free list is not used since its slots are
+    scattered.
+
+  \param count
+    The number of nodes, must be at least 1.
+
+  \return
+    Returns a pointer to uninitialized storage for count nodes.
+*/
+/**************************************************************************/
+template <typename Node, typename Alloc, int InlineNodes>
+void *NodePool<Node, Alloc, InlineNodes>::acquire_block(int count)
+{
+  //Slots are used as an array of nodes, so they must be the same size.
+  static_assert(sizeof(Slot) == sizeof(Node),
+                "node slots must be laid out like a node array");
+
+  //Allocate a slab just for the block if the newest one is too small.
+  if (end_ - cursor_ < count)
+    grow(count);
+
+  //Carve the block out of the newest slab.
+  Slot *block = cursor_;
+  cursor_ += count;
+
+  return block;
+}
+
+/**************************************************************************/
+/*!
+  \brief
+    Puts the storage of a destroyed node on the free list.
+
+  \param storage
+    The storage that was returned by acquire.
+*/
+/**************************************************************************/
+template <typename Node, typename Alloc, int InlineNodes>
+void NodePool<Node, Alloc, InlineNodes>::release(void *storage)
+{
+  //Push the slot onto the front of the free list.
+  Slot *slot = static_cast<Slot *>(storage);
+  slot->next = free_;
+  free_ = slot;
+}
+
+/**************************************************************************/
+/*!
+  \brief
+    Returns every slab owned by the pool to the allocator at once and
+    starts over with an empty pool. All nodes must be destroyed already.
+*/
+/**************************************************************************/
+template <typename Node, typename Alloc, int InlineNodes>
+void NodePool<Node, Alloc, InlineNodes>::release_all()
+{
+  //Walk the chain of slabs and free each of them.
+  while (slabs_)
+  {
+    SlabHeader *header = reinterpret_cast<SlabHeader *>(slabs_);
+    Slot *next = header->next;
+
+    alloc_.deallocate(slabs_, header->capacity + 1);
+
+    slabs_ = next;
+  }
+
+  //Only the inline slots are left to hand out.
+  free_ = 0;
+  cursor_ = inline_;
+  end_ = inline_ + InlineNodes;
+  capacity_ = 0;
+}
+
+/**************************************************************************/
+/*!
+  \brief
+    Moves every slab and free slot of another pool into this one. The
+    nodes that were allocated from the other pool's slabs stay where they
+    are but are now owned (and eventually freed) by this pool. The other
+    pool's inline slots can not move, so nodes still living in them must
+    be moved out by the caller first. Both pools must use allocators that
+    compare equal.
+
+  \param other
+    The pool to take the slabs from, it is left empty.
+*/
+/**************************************************************************/
+template <typename Node, typename Alloc, int InlineNodes>
+void NodePool<Node, Alloc, InlineNodes>::adopt(NodePool &other)
+{
+  //Nothing to take from this pool.
+  if (&other == this)
+    return;
+
+  //Keep the untouched slots of the other pool's newest slab.
+  if (!other.is_inline(other.cursor_))
+    while (other.cursor_ != other.end_)
+      release(other.cursor_++);
+
+  //Move the other pool's free slots, except its inline ones.
+  while (other.free_)
+  {
+    Slot *slot = other.free_;
+    other.free_ = slot->next;
+
+    if (!other.is_inline(slot))
+      release(slot);
+  }
+
+  //Link this pool's slabs after the other pool's slabs.
+  if (other.slabs_)
+  {
+    Slot *last = other.slabs_;
+    while (reinterpret_cast<SlabHeader *>(last)->next)
+      last = reinterpret_cast<SlabHeader *>(last)->next;
+
+    reinterpret_cast<SlabHeader *>(last)->next = slabs_;
+    slabs_ = other.slabs_;
+  }
+
+  //The other pool starts over with only its inline slots.
+  other.slabs_ = 0;
+  other.cursor_ = other.inline_;
+  other.end_ = other.inline_ + InlineNodes;
+  other.capacity_ = 0;
+}
+
+/**************************************************************************/
+/*!
+  \brief
+    Gets a copy of the allocator used by the pool.
+
+  \return
+    Returns the allocator, rebound to the node type.
+*/
+/**************************************************************************/
+template <typename Node, typename Alloc, int InlineNodes>
+Alloc NodePool<Node, Alloc, InlineNodes>::allocator() const
+{
+  return Alloc(alloc_);
+}
+
+/**************************************************************************/
+/*!
+  \brief
+    Allocates a new slab and links it into the chain of owned slabs. Any
+    slots left in the previous newest slab are put on the free list.
+
+  \param capacity
+    The number of nodes the slab can hold.
+*/
+/**************************************************************************/
+template <typename Node, typename Alloc, int InlineNodes>
+void NodePool<Node, Alloc, InlineNodes>::grow(int capacity)
+{
+  //Keep the untouched slots of the current slab.
+  while (cursor_ != end_)
+    release(cursor_++);
+
+  //One extra slot holds the slab header.
+  Slot *slab = alloc_.allocate(capacity + 1);
+
+  //Link the slab into the chain.
+  SlabHeader *header = reinterpret_cast<SlabHeader *>(slab);
+  header->next = slabs_;
+  header->capacity = capacity;
+  slabs_ = slab;
+
+  //Carve from the slots after the header.
+  cursor_ = slab + 1;
+  end_ = slab + 1 + capacity;
+  capacity_ = capacity;
+}
+
+/**************************************************************************/
+/*!
+  \brief
+    Checks whether the storage is one of the inline slots of this pool.
+
+  \param storage
+    The storage of a node.
+
+  \return
+    Returns true if the storage lives inside the pool object.
+*/
+/**************************************************************************/
+template <typename Node, typename Alloc, int InlineNodes>
+bool NodePool<Node, Alloc, InlineNodes>::is_inline(const void *storage) const
+{
+  std::less<const void *> before;
+
+  return !before(storage, inline_) && before(storage, inline_ + InlineNodes);
+}
@@ -0,0 +1,121 @@
+/*****************************************************************************/
+/*!
+\file   NodePool.h
+\author Rohit Saini
+\par    email: rohitsaini429@gmail.com
+
+\brief
+    This file contains the definition of a pooled node allocator used by
+    the templated Linked List. Nodes are carved out of contiguous slabs in
+    the order they are requested, and released nodes are kept on a free
+    list so that they can be handed out again without touching the heap.
+    The first InlineNodes nodes are carved out of storage inside the pool
+    itself, so a small list never touches the heap at all.
+*/
+/*****************************************************************************/
+#ifndef NODEPOOL_H
+#define NODEPOOL_H
+
+#include <functional>  /* less */
+#include <memory>      /* allocator, allocator_traits */
+#include <type_traits> /* aligned_storage */
+
+//! Slab based pool of raw node storage
+template <typename Node, typename Alloc = std::allocator<Node>, int InlineNodes = 0>
+class NodePool
+{
+  public:
+
+    //! Constructor, slabs will be requested from the given allocator
+    explicit NodePool(const Alloc &alloc = Alloc());
+
+    //! Destructor, returns every slab to the allocator
+    ~NodePool();
+
+    //! Returns storage for one node (the node is NOT constructed)
+    void *acquire();
+
+    //! Returns storage for count nodes that are next to each other, so it
+    //! can be used as a Node array (the nodes are NOT constructed)
+    void *acquire_block(int count);
+
+    //! Puts the storage of an already destroyed node on the free list
+    void release(void *storage);
+
+    //! Returns every slab to the allocator, all nodes must be destroyed
+    void release_all();
+
+    //! Takes ownership of every slab of another pool, so nodes allocated
+    //! from it can be moved into a list that uses this pool
+    void adopt(NodePool &other);
+
+    //! Returns the allocator used for the slabs
+    Alloc allocator() const;
+
+    //! true if the storage is one of the inline slots of this pool
+    bool is_inline(const void *storage) const;
+
+  private:
+
+    //! Storage for one node, or a link while on the free list
+    union Slot
+    {
+      //! next free slot
+      Slot *next;
+
+      //! raw memory for the node
+      typename std::aligned_storage<sizeof(Node), alignof(Node)>::type storage;
+    };
+
+    //! Lives in the first slot of every slab
+    struct SlabHeader
+    {
+      //! next slab owned by the pool
+      Slot *next;
+
+      //! number of usable slots in the slab
+      int capacity;
+    };
+
+    //! The allocator type that provides the slabs
+    typedef typename std::allocator_traits<Alloc>::template rebind_alloc<Slot>
+      SlotAllocator;
+
+    //! number of slots in the first slab
+    static const int FIRST_SLAB = 8;
+
+    //! slabs stop doubling once they reach this many slots
+    static const int MAX_SLAB = 1024;
+
+    //! Allocates a new slab and makes it the one to carve from
+    void grow(int capacity);
+
+    //! Disable copying, a pool owns its slabs
+    NodePool(const NodePool &);
+    NodePool &operator=(const NodePool &);
+
+    //! allocator used for the slabs
+    SlotAllocator alloc_;
+
+    //! first slab in the chain of owned slabs
+    Slot *slabs_;
+
+    //! first slot on the free list
+    Slot *free_;
+
+    //! next untouched slot in the newest slab
+    Slot *cursor_;
+
+    //! one past the last slot in the newest slab
+    Slot *end_;
+
+    //! capacity of the newest slab
+    int capacity_;
+
+    //! slots used before any slab is allocated
+    Slot inline_[InlineNodes > 0 ? InlineNodes : 1];
+};
+
+#include "NodePool.cpp"
+
+#endif